@@ -0,0 +1,467 @@
+/**
+ *
+ * @file:       freertos_sim.c
+ * @brief:      Virtual clock, esp_timer and a cooperative FreeRTOS stand-in for the host build.
+ -------------------------------------------------------------------------------------------------*/
+
+#include "lcd_sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#define SIM_MAX_TASKS       16
+#define SIM_MAX_TIMERS      16
+#define SIM_STACK_SIZE      (256 * 1024)
+#define SIM_TICK_US         ((int64_t)portTICK_PERIOD_MS * 1000)
+
+struct host_task {
+    ucontext_t ctx;
+    void *stack;
+    TaskFunction_t fn;
+    void *arg;
+    bool used;
+    bool finished;
+    int64_t deadline;
+    uint32_t notify;
+};
+
+struct esp_timer {
+    esp_timer_cb_t cb;
+    void *arg;
+    bool used;
+    int64_t deadline;
+    uint64_t period;
+};
+
+struct host_queue {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+struct host_event_group {
+    EventBits_t bits;
+};
+
+static int64_t now_us;
+static lcd_sim_stats_t stats;
+static struct host_task tasks[SIM_MAX_TASKS] = { [0] = { .used = true, .deadline = -1 } };
+static struct esp_timer timers[SIM_MAX_TIMERS];
+static uint8_t current;
+static uint8_t idle_streak;
+static bool firing;
+
+void lcd_sim_power_cycle_devices(void);
+
+lcd_sim_stats_t *lcd_sim_stats_mut(void) {
+    return &stats;
+}
+
+const lcd_sim_stats_t *lcd_sim_stats(void) {
+    return &stats;
+}
+
+void lcd_sim_clear_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+int64_t lcd_sim_now_us(void) {
+    return now_us;
+}
+
+/**
+ * @brief Fires every timer that is due at the current time, oldest deadline first.
+ */
+static void fire_timers(void) {
+    if(firing) return;
+    firing = true;
+
+    for(;;) {
+        struct esp_timer *due = NULL;
+        for(uint8_t i = 0; i < SIM_MAX_TIMERS; i++) {
+            if(timers[i].used && timers[i].deadline >= 0 && timers[i].deadline <= now_us &&
+               (due == NULL || timers[i].deadline < due->deadline)) due = &timers[i];
+        }
+        if(due == NULL) break;
+
+        due->deadline = due->period ? due->deadline + (int64_t)due->period : -1;
+        due->cb(due->arg);
+    }
+
+    firing = false;
+}
+
+void lcd_sim_advance_us(int64_t us) {
+    int64_t target = now_us + us;
+
+    // Step through timer deadlines on the way so callbacks see the time they were due at
+    for(;;) {
+        int64_t next = target;
+        for(uint8_t i = 0; i < SIM_MAX_TIMERS; i++) {
+            if(timers[i].used && timers[i].deadline >= 0 && timers[i].deadline < next) next = timers[i].deadline;
+        }
+        if(next > now_us) now_us = next;
+        fire_timers();
+        if(now_us >= target) break;
+    }
+}
+
+/* Scheduler ---------------------------------------------------------------------------------------*/
+
+/**
+ * @brief Switches to the next task that has not finished. When every task has yielded
+ * without making progress the clock jumps to the earliest deadline.
+ */
+static void yield_idle(void) {
+    uint8_t alive = 0;
+    for(uint8_t i = 0; i < SIM_MAX_TASKS; i++) {
+        if(tasks[i].used && !tasks[i].finished) alive++;
+    }
+
+    if(++idle_streak >= alive) {
+        idle_streak = 0;
+
+        int64_t next = -1;
+        for(uint8_t i = 0; i < SIM_MAX_TASKS; i++) {
+            if(tasks[i].used && !tasks[i].finished && tasks[i].deadline >= 0 && (next < 0 || tasks[i].deadline < next)) next = tasks[i].deadline;
+        }
+        for(uint8_t i = 0; i < SIM_MAX_TIMERS; i++) {
+            if(timers[i].used && timers[i].deadline >= 0 && (next < 0 || timers[i].deadline < next)) next = timers[i].deadline;
+        }
+
+        if(next < 0) {
+            fprintf(stderr, "lcd_sim: every task is waiting forever\n");
+            abort();
+        }
+        if(next > now_us) lcd_sim_advance_us(next - now_us);
+    }
+
+    uint8_t prev = current;
+    for(uint8_t i = 1; i <= SIM_MAX_TASKS; i++) {
+        uint8_t idx = (prev + i) % SIM_MAX_TASKS;
+        if(tasks[idx].used && !tasks[idx].finished) {
+            current = idx;
+            break;
+        }
+    }
+
+    if(current != prev) swapcontext(&tasks[prev].ctx, &tasks[current].ctx);
+}
+
+bool lcd_sim_wait(bool (*cond)(void *ctx), void *ctx, int64_t deadline_us) {
+    int64_t start = now_us;
+    tasks[current].deadline = deadline_us;
+
+    while(!cond(ctx)) {
+        if(deadline_us >= 0 && now_us >= deadline_us) {
+            tasks[current].deadline = -1;
+            stats.sleep_us += now_us - start;
+            return false;
+        }
+        yield_idle();
+    }
+
+    tasks[current].deadline = -1;
+    idle_streak = 0;
+    stats.sleep_us += now_us - start;
+    return true;
+}
+
+static bool never(void *ctx) {
+    (void)ctx;
+    return false;
+}
+
+void lcd_sim_run_for_us(int64_t us) {
+    lcd_sim_wait(never, NULL, now_us + us);
+}
+
+/**
+ * @brief Converts a FreeRTOS timeout to a virtual deadline.
+ */
+static int64_t deadline_of(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? -1 : now_us + (int64_t)ticks * SIM_TICK_US;
+}
+
+static void task_entry(void) {
+    struct host_task *task = &tasks[current];
+    task->fn(task->arg);
+
+    // Returning from a FreeRTOS task is not allowed, but finish cleanly if it happens
+    task->finished = true;
+    yield_idle();
+}
+
+void lcd_sim_reset(void) {
+    for(uint8_t i = 0; i < SIM_MAX_TASKS; i++) {
+        if(i == current) continue;
+        free(tasks[i].stack);
+        memset(&tasks[i], 0, sizeof(tasks[i]));
+    }
+    memset(timers, 0, sizeof(timers));
+    tasks[current].deadline = -1;
+    tasks[current].notify = 0;
+    idle_streak = 0;
+    now_us = 0;
+    lcd_sim_clear_stats();
+    lcd_sim_power_cycle_devices();
+}
+
+/* Tasks -------------------------------------------------------------------------------------------*/
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *out_task) {
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    for(uint8_t i = 0; i < SIM_MAX_TASKS; i++) {
+        if(tasks[i].used) continue;
+
+        struct host_task *task = &tasks[i];
+        memset(task, 0, sizeof(*task));
+        task->stack = malloc(SIM_STACK_SIZE);
+        if(task->stack == NULL) return pdFAIL;
+
+        getcontext(&task->ctx);
+        task->ctx.uc_stack.ss_sp = task->stack;
+        task->ctx.uc_stack.ss_size = SIM_STACK_SIZE;
+        task->ctx.uc_link = NULL;
+        makecontext(&task->ctx, task_entry, 0);
+
+        task->fn = fn;
+        task->arg = arg;
+        task->deadline = -1;
+        task->used = true;
+
+        if(out_task != NULL) *out_task = task;
+        return pdPASS;
+    }
+
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if(task == NULL) task = &tasks[current];
+    task->finished = true;
+    if(task == &tasks[current]) yield_idle();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return &tasks[current];
+}
+
+void vTaskDelay(TickType_t ticks) {
+    lcd_sim_wait(never, NULL, now_us + (int64_t)ticks * SIM_TICK_US);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(now_us / SIM_TICK_US);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    task->notify++;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+    task->notify++;
+    if(higher_priority_task_woken != NULL) *higher_priority_task_woken = pdTRUE;
+}
+
+static bool notified(void *ctx) {
+    return ((struct host_task *)ctx)->notify > 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    struct host_task *task = &tasks[current];
+    if(!lcd_sim_wait(notified, task, deadline_of(ticks_to_wait))) return 0;
+
+    uint32_t value = task->notify;
+    task->notify = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+/* Queues and semaphores ---------------------------------------------------------------------------*/
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue *queue = calloc(1, sizeof(*queue));
+    if(queue == NULL) return NULL;
+
+    queue->items = calloc(length, item_size ? item_size : 1);
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if(queue == NULL) return;
+    free(queue->items);
+    free(queue);
+}
+
+static bool queue_has_space(void *ctx) {
+    struct host_queue *queue = ctx;
+    return queue->count < queue->length;
+}
+
+static bool queue_has_items(void *ctx) {
+    return ((struct host_queue *)ctx)->count > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    // Without a wait this is safe from timer callbacks, which run on the stack of another task
+    if(ticks_to_wait == 0 ? !queue_has_space(queue) : !lcd_sim_wait(queue_has_space, queue, deadline_of(ticks_to_wait))) return pdFAIL;
+
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    if(queue->item_size) memcpy(&queue->items[tail * queue->item_size], item, queue->item_size);
+    queue->count++;
+    return pdPASS;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    if(queue->count == queue->length) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    if(!lcd_sim_wait(queue_has_items, queue, deadline_of(ticks_to_wait))) return pdFAIL;
+
+    if(queue->item_size) memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    SemaphoreHandle_t sem = xQueueCreate(1, 0);
+    if(sem != NULL) sem->count = 1;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xQueueCreate(1, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    vQueueDelete(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    return xQueueReceive(sem, NULL, ticks_to_wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return xQueueSend(sem, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *higher_priority_task_woken) {
+    if(higher_priority_task_woken != NULL) *higher_priority_task_woken = pdFALSE;
+    return xQueueSend(sem, NULL, 0);
+}
+
+/* Event groups ------------------------------------------------------------------------------------*/
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    return calloc(1, sizeof(struct host_event_group));
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    free(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    group->bits |= bits;
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+typedef struct {
+    EventGroupHandle_t group;
+    EventBits_t bits;
+    bool all;
+} bits_wait_t;
+
+static bool bits_set(void *ctx) {
+    bits_wait_t *wait = ctx;
+    EventBits_t set = wait->group->bits & wait->bits;
+    return wait->all ? set == wait->bits : set != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_for_all, TickType_t ticks_to_wait) {
+    bits_wait_t wait = { group, bits, wait_for_all };
+    bool ok = lcd_sim_wait(bits_set, &wait, deadline_of(ticks_to_wait));
+
+    EventBits_t value = group->bits;
+    if(ok && clear_on_exit) group->bits &= ~bits;
+    return value;
+}
+
+/* esp_timer and esp_rom ---------------------------------------------------------------------------*/
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle) {
+    for(uint8_t i = 0; i < SIM_MAX_TIMERS; i++) {
+        if(timers[i].used) continue;
+
+        timers[i] = (struct esp_timer){ .cb = args->callback, .arg = args->arg, .used = true, .deadline = -1 };
+        *out_handle = &timers[i];
+        return ESP_OK;
+    }
+
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if(timer->deadline >= 0) return ESP_ERR_INVALID_STATE;
+    timer->deadline = now_us + (int64_t)timeout_us;
+    timer->period = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    if(timer->deadline >= 0) return ESP_ERR_INVALID_STATE;
+    timer->deadline = now_us + (int64_t)period_us;
+    timer->period = period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if(timer->deadline < 0) return ESP_ERR_INVALID_STATE;
+    timer->deadline = -1;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    timer->used = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void) {
+    return now_us;
+}
+
+void esp_rom_delay_us(uint32_t us) {
+    stats.sleep_us += us;
+    lcd_sim_advance_us(us);
+}
@@ -0,0 +1,592 @@
+/**
+ *
+ * @file:       hd44780_sim.c
+ * @brief:      Host-side i2c master with emulated PCF8574 + HD44780 displays as devices.
+ * @details
+ * Every byte written to a device is latched on the expander pins (P0 RS, P1 R/W, P2 E,
+ * P3 backlight, P4-P7 D4-D7). A falling edge on E clocks a nibble into the controller,
+ * a rising edge with R/W high makes the controller drive the data pins for reading. Each
+ * byte is handled at the virtual time it finishes on the wire, so instructions that reach
+ * the controller before the previous one has finished are counted as timing violations.
+ * A bus created with a trans_queue_depth queues transfers like the ESP-IDF driver does: the
+ * caller only pays for setting a transfer up, the bytes reach the device when the transfer
+ * is done on the wire and the device's on_trans_done callback is called from a timer.
+ -------------------------------------------------------------------------------------------------*/
+
+#include "lcd_sim.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIN_RS      0x01
+#define PIN_RW      0x02
+#define PIN_E       0x04
+#define PIN_BL      0x08
+
+#define EXEC_US         37          /**< Execution time of most instructions */
+#define EXEC_DATA_US    41          /**< Execution time of data reads and writes */
+#define EXEC_CLEAR_US   1520        /**< Execution time of clear display and return home */
+#define POWER_ON_US     15000       /**< Time from power on until the controller accepts instructions */
+#define SIM_MAX_QUEUE   16          /**< Max trans_queue_depth of the emulated bus */
+
+typedef struct {
+    bool used;
+    uint16_t address;
+    uint32_t scl_hz;
+    uint32_t max_scl_hz;            /**< Fastest clock the wiring carries cleanly, 0 for no limit */
+    uint8_t port;                   /**< Last byte written to the expander */
+    bool low_half;                  /**< Next nibble is the low half of a byte */
+    uint8_t high_nibble;            /**< High half waiting for the low half */
+    uint8_t read_value;             /**< Byte being read in two nibbles */
+    uint8_t drive;                  /**< Data pins driven by the controller while E is high */
+    bool driving;                   /**< The controller drives the data pins */
+    uint8_t resets;                 /**< 8-bit function sets seen since power on */
+    int64_t busy_until;             /**< Virtual time the current instruction finishes */
+    uint32_t fail_count;            /**< Transfers left to fail */
+    esp_err_t fail_err;             /**< Error of failing transfers */
+    lcd_sim_hd44780_t lcd;          /**< The controller */
+} sim_device_t;
+
+struct i2c_master_dev_t;
+
+/**
+ * @brief A transfer waiting in the queue of a bus with a trans_queue_depth.
+ */
+typedef struct {
+    struct i2c_master_dev_t *handle;    /**< Device the transfer is for */
+    const uint8_t *write;               /**< Bytes to write, NULL for a read */
+    uint8_t *read;                      /**< Buffer to read into, NULL for a write */
+    size_t size;                        /**< Data bytes */
+    int64_t start;                      /**< Virtual time the transfer starts on the wire */
+    int64_t done;                       /**< Virtual time the stop condition is sent */
+    esp_err_t err;                      /**< Injected failure or ESP_OK */
+} sim_transfer_t;
+
+struct i2c_master_bus_t {
+    bool used;
+    size_t queue_depth;                 /**< Transfers queued in the background, 0 for blocking transfers */
+    sim_transfer_t queue[SIM_MAX_QUEUE];/**< Queued transfers, oldest at head */
+    uint8_t head;                       /**< Index of the oldest queued transfer */
+    uint8_t count;                      /**< Queued transfers */
+    int64_t free_at;                    /**< Virtual time the last queued transfer leaves the wire */
+    esp_timer_handle_t timer;           /**< Fires when the oldest queued transfer is done */
+};
+
+struct i2c_master_dev_t {
+    sim_device_t *device;
+    i2c_master_callback_t on_trans_done;    /**< Called when a queued transfer is done */
+    void *user_data;                        /**< Passed to on_trans_done */
+};
+
+static struct i2c_master_bus_t bus;
+static sim_device_t devices[LCD_SIM_MAX_DEVICES];
+static struct i2c_master_dev_t handles[LCD_SIM_MAX_DEVICES];
+
+lcd_sim_stats_t *lcd_sim_stats_mut(void);
+
+/**
+ * @brief Puts the controller in its power on state.
+ */
+static void power_on(sim_device_t *dev) {
+    uint16_t address = dev->address;
+    uint32_t scl_hz = dev->scl_hz;
+    uint32_t max_scl_hz = dev->max_scl_hz;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->used = true;
+    dev->address = address;
+    dev->scl_hz = scl_hz;
+    dev->max_scl_hz = max_scl_hz;
+    dev->busy_until = lcd_sim_now_us() + POWER_ON_US;
+
+    // Internal reset circuit: clear display, 8-bit, one line, display off, increment
+    memset(dev->lcd.ddram, ' ', sizeof(dev->lcd.ddram));
+    dev->lcd.increment = true;
+}
+
+static sim_device_t *find_device(uint16_t address) {
+    for(uint8_t i = 0; i < LCD_SIM_MAX_DEVICES; i++) {
+        if(devices[i].used && devices[i].address == address) return &devices[i];
+    }
+    return NULL;
+}
+
+/* HD44780 -----------------------------------------------------------------------------------------*/
+
+/**
+ * @brief Moves the address counter one step in the entry mode direction.
+ */
+static void step_ac(lcd_sim_hd44780_t *lcd, bool forward) {
+    if(lcd->in_cgram) {
+        lcd->ac = (lcd->ac + (forward ? 1 : -1)) & 0x3F;
+        return;
+    }
+
+    if(lcd->two_lines) {
+        if(forward) lcd->ac = lcd->ac == 0x27 ? 0x40 : lcd->ac == 0x67 ? 0x00 : lcd->ac + 1;
+        else lcd->ac = lcd->ac == 0x40 ? 0x27 : lcd->ac == 0x00 ? 0x67 : lcd->ac - 1;
+    }
+    else {
+        if(forward) lcd->ac = lcd->ac >= 0x4F ? 0x00 : lcd->ac + 1;
+        else lcd->ac = lcd->ac == 0x00 ? 0x4F : lcd->ac - 1;
+    }
+}
+
+/**
+ * @brief Returns the DDRAM cell the address counter points at.
+ */
+static uint8_t *ddram_cell(lcd_sim_hd44780_t *lcd) {
+    if(lcd->two_lines) {
+        uint8_t line = lcd->ac >= 0x40 ? 1 : 0;
+        return &lcd->ddram[line][(lcd->ac & 0x3F) % LCD_SIM_DDRAM_COLS];
+    }
+    uint8_t addr = lcd->ac % (2 * LCD_SIM_DDRAM_COLS);
+    return &lcd->ddram[addr / LCD_SIM_DDRAM_COLS][addr % LCD_SIM_DDRAM_COLS];
+}
+
+static void shift_display(lcd_sim_hd44780_t *lcd, bool left) {
+    lcd->shift = (lcd->shift + (left ? 1 : LCD_SIM_DDRAM_COLS - 1)) % LCD_SIM_DDRAM_COLS;
+}
+
+/**
+ * @brief Executes a full byte written to the controller.
+ */
+static void execute(sim_device_t *dev, uint8_t value, bool rs, int64_t t) {
+    lcd_sim_hd44780_t *lcd = &dev->lcd;
+    lcd_sim_stats_t *stats = lcd_sim_stats_mut();
+    int64_t exec = EXEC_US;
+
+    if(t < dev->busy_until) stats->timing_violations++;
+
+    if(rs) {
+        if(lcd->in_cgram) lcd->cgram[lcd->ac & 0x3F] = value;
+        else *ddram_cell(lcd) = value;
+
+        step_ac(lcd, lcd->increment);
+        if(lcd->shift_on_write && !lcd->in_cgram) shift_display(lcd, lcd->increment);
+        stats->data_writes++;
+        exec = EXEC_DATA_US;
+    }
+    else {
+        stats->instructions++;
+
+        if(value & 0x80) {
+            lcd->in_cgram = false;
+            lcd->ac = value & 0x7F;
+        }
+        else if(value & 0x40) {
+            lcd->in_cgram = true;
+            lcd->ac = value & 0x3F;
+        }
+        else if(value & 0x20) {
+            // Function set, the first ones after power on are the 8-bit reset sequence
+            lcd->four_bit = !(value & 0x10);
+            lcd->two_lines = (value & 0x08) != 0;
+            if(!lcd->four_bit && dev->resets < 2) exec = dev->resets++ == 0 ? 4100 : 100;
+        }
+        else if(value & 0x10) {
+            bool left = !(value & 0x04);
+            if(value & 0x08) shift_display(lcd, left);
+            else step_ac(lcd, !left);
+        }
+        else if(value & 0x08) {
+            lcd->display_on = (value & 0x04) != 0;
+            lcd->cursor_on = (value & 0x02) != 0;
+            lcd->blink = (value & 0x01) != 0;
+        }
+        else if(value & 0x04) {
+            lcd->increment = (value & 0x02) != 0;
+            lcd->shift_on_write = (value & 0x01) != 0;
+        }
+        else if(value & 0x02) {
+            lcd->in_cgram = false;
+            lcd->ac = 0;
+            lcd->shift = 0;
+            exec = EXEC_CLEAR_US;
+        }
+        else if(value & 0x01) {
+            memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+            lcd->in_cgram = false;
+            lcd->ac = 0;
+            lcd->shift = 0;
+            lcd->increment = true;
+            exec = EXEC_CLEAR_US;
+        }
+    }
+
+    dev->busy_until = t + exec;
+}
+
+/**
+ * @brief Latches a byte on the expander pins at virtual time t.
+ */
+static void port_write(sim_device_t *dev, uint8_t value, int64_t t) {
+    uint8_t prev = dev->port;
+    dev->port = value;
+    dev->lcd.backlight = (value & PIN_BL) != 0;
+
+    bool rise = !(prev & PIN_E) && (value & PIN_E);
+    bool fall = (prev & PIN_E) && !(value & PIN_E);
+
+    if(rise && (value & PIN_RW)) {
+        // Read: the controller drives the data pins while E is high
+        bool rs = (value & PIN_RS) != 0;
+
+        if(!dev->lcd.four_bit || !dev->low_half) {
+            if(rs) {
+                if(t < dev->busy_until) lcd_sim_stats_mut()->timing_violations++;
+                dev->read_value = dev->lcd.in_cgram ? dev->lcd.cgram[dev->lcd.ac & 0x3F] : *ddram_cell(&dev->lcd);
+            }
+            else {
+                dev->read_value = (t < dev->busy_until ? 0x80 : 0x00) | (dev->lcd.ac & 0x7F);
+            }
+            dev->drive = dev->read_value & 0xF0;
+        }
+        else {
+            dev->drive = (dev->read_value << 4) & 0xF0;
+        }
+        dev->driving = true;
+    }
+    else if(fall && (prev & PIN_RW)) {
+        dev->driving = false;
+
+        bool done = !dev->lcd.four_bit || dev->low_half;
+        if(dev->lcd.four_bit) dev->low_half = !dev->low_half;
+
+        if(done && (prev & PIN_RS)) {
+            step_ac(&dev->lcd, dev->lcd.increment);
+            dev->busy_until = t + EXEC_DATA_US;
+        }
+    }
+    else if(fall) {
+        uint8_t nibble = prev & 0xF0;
+        bool rs = (prev & PIN_RS) != 0;
+
+        if(!dev->lcd.four_bit) {
+            execute(dev, nibble, rs, t);
+            if(dev->lcd.four_bit) dev->low_half = false;
+        }
+        else if(!dev->low_half) {
+            dev->high_nibble = nibble;
+            dev->low_half = true;
+        }
+        else {
+            dev->low_half = false;
+            execute(dev, dev->high_nibble | (nibble >> 4), rs, t);
+        }
+    }
+    else if(!(value & PIN_E)) {
+        dev->driving = false;
+    }
+}
+
+/* Emulator API ------------------------------------------------------------------------------------*/
+
+const lcd_sim_hd44780_t *lcd_sim_display(uint16_t address) {
+    sim_device_t *dev = find_device(address);
+    return dev != NULL ? &dev->lcd : NULL;
+}
+
+void lcd_sim_screen(uint16_t address, char rows[2][17]) {
+    const lcd_sim_hd44780_t *lcd = lcd_sim_display(address);
+
+    for(uint8_t row = 0; row < 2; row++) {
+        for(uint8_t col = 0; col < 16; col++) {
+            uint8_t c = lcd != NULL ? lcd->ddram[row][(col + lcd->shift) % LCD_SIM_DDRAM_COLS] : ' ';
+            rows[row][col] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+        }
+        rows[row][16] = '\0';
+    }
+}
+
+void lcd_sim_fail_transfers(uint16_t address, uint32_t count, esp_err_t err) {
+    sim_device_t *dev = find_device(address);
+    if(dev == NULL) return;
+    dev->fail_count = count;
+    dev->fail_err = err;
+}
+
+void lcd_sim_set_max_scl(uint16_t address, uint32_t hz) {
+    sim_device_t *dev = find_device(address);
+    if(dev != NULL) dev->max_scl_hz = hz;
+}
+
+void lcd_sim_desync(uint16_t address) {
+    sim_device_t *dev = find_device(address);
+    if(dev != NULL) dev->low_half = !dev->low_half;
+}
+
+void lcd_sim_corrupt(uint16_t address, uint8_t line, uint8_t col, uint8_t value) {
+    sim_device_t *dev = find_device(address);
+    if(dev != NULL && line < 2 && col < LCD_SIM_DDRAM_COLS) dev->lcd.ddram[line][col] = value;
+}
+
+void lcd_sim_power_cycle_devices(void) {
+    for(uint8_t i = 0; i < LCD_SIM_MAX_DEVICES; i++) {
+        if(devices[i].used) power_on(&devices[i]);
+    }
+
+    // The timers are gone after a reset, and so is everything queued on the bus
+    bus.head = 0;
+    bus.count = 0;
+    bus.free_at = 0;
+    bus.timer = NULL;
+}
+
+/* i2c master --------------------------------------------------------------------------------------*/
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle) {
+    if(bus.used) return ESP_ERR_INVALID_STATE;
+    if(bus_config->trans_queue_depth > SIM_MAX_QUEUE) return ESP_ERR_INVALID_ARG;
+
+    bus.used = true;
+    bus.queue_depth = bus_config->trans_queue_depth;
+    *ret_bus_handle = &bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle) {
+    bus_handle->used = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config, i2c_master_dev_handle_t *ret_handle) {
+    (void)bus_handle;
+    static uint8_t next_handle;
+
+    // A display that was removed and added again is still powered and keeps its state
+    sim_device_t *dev = find_device(dev_config->device_address);
+    for(uint8_t i = 0; i < LCD_SIM_MAX_DEVICES && dev == NULL; i++) {
+        if(devices[i].used) continue;
+
+        dev = &devices[i];
+        dev->address = dev_config->device_address;
+        power_on(dev);
+    }
+    if(dev == NULL) return ESP_ERR_NO_MEM;
+
+    // Hand out handles round robin, like a heap a new handle rarely equals the one just freed
+    for(uint8_t i = 0; i < LCD_SIM_MAX_DEVICES; i++) {
+        struct i2c_master_dev_t *handle = &handles[(next_handle + i) % LCD_SIM_MAX_DEVICES];
+        if(handle->device != NULL) continue;
+
+        next_handle = (next_handle + i + 1) % LCD_SIM_MAX_DEVICES;
+        dev->scl_hz = dev_config->scl_speed_hz;
+        *handle = (struct i2c_master_dev_t){ .device = dev };
+        *ret_handle = handle;
+        return ESP_OK;
+    }
+
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle) {
+    handle->device = NULL;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus_handle) {
+    (void)bus_handle;
+    lcd_sim_advance_us(100);
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns the virtual time one i2c bit takes for the device, in microseconds.
+ */
+static double bit_us(const sim_device_t *dev) {
+    return 1e6 / (double)(dev->scl_hz ? dev->scl_hz : 100000);
+}
+
+/**
+ * @brief Takes the next injected failure of a device.
+ * 
+ * @return the error to fail the transfer with or ESP_OK.
+ */
+static esp_err_t take_failure(sim_device_t *dev) {
+    if(dev->fail_count == 0) return ESP_OK;
+
+    dev->fail_count--;
+    return dev->fail_err;
+}
+
+/**
+ * @brief Returns the time a transaction of size bytes takes on the wire. A failed one ends
+ * after the address byte.
+ */
+static int64_t wire_us(const sim_device_t *dev, size_t size, esp_err_t err) {
+    // Start, address byte + ack, data bytes + ack, stop
+    if(err != ESP_OK) return (int64_t)(11 * bit_us(dev));
+    return (int64_t)((2 + 9 * (1 + size)) * bit_us(dev) + 0.5);
+}
+
+/**
+ * @brief Returns the bits that flip on the wire: D4 when the clock is faster than the wiring
+ * carries, nothing otherwise.
+ */
+static uint8_t line_noise(const sim_device_t *dev) {
+    return dev->max_scl_hz != 0 && dev->scl_hz > dev->max_scl_hz ? 0x10 : 0x00;
+}
+
+/**
+ * @brief Latches the bytes of a write whose first data byte starts at virtual time start.
+ */
+static void write_bytes(sim_device_t *dev, const uint8_t *buf, size_t size, int64_t start) {
+    for(size_t i = 0; i < size; i++) {
+        int64_t t = start + (int64_t)((1 + 9 * (i + 2)) * bit_us(dev));
+        port_write(dev, buf[i] ^ line_noise(dev), t);
+    }
+}
+
+/**
+ * @brief Samples the expander pins for a read.
+ */
+static void read_bytes(sim_device_t *dev, uint8_t *buf, size_t size) {
+    // Quasi-bidirectional pins read back high unless written low or pulled low by the controller
+    for(size_t i = 0; i < size; i++) {
+        uint8_t data = dev->driving ? (dev->port & 0xF0 & (dev->drive | 0x0F)) : (dev->port & 0xF0);
+        buf[i] = (data | (dev->port & 0x0F)) ^ line_noise(dev);
+    }
+}
+
+/**
+ * @brief Counts the data bytes of a transaction that goes through.
+ */
+static void count_bytes(bool write, size_t size) {
+    lcd_sim_stats_t *stats = lcd_sim_stats_mut();
+
+    if(write) stats->bytes_written += size;
+    else stats->bytes_read += size;
+}
+
+/**
+ * @brief Runs a blocking transaction, the caller waits until it has left the wire.
+ */
+static esp_err_t blocking_transfer(sim_device_t *dev, const uint8_t *write, uint8_t *read, size_t size) {
+    lcd_sim_stats_t *stats = lcd_sim_stats_mut();
+    stats->transactions++;
+
+    esp_err_t err = take_failure(dev);
+    if(err == ESP_OK) {
+        if(write != NULL) write_bytes(dev, write, size, lcd_sim_now_us() + LCD_SIM_TXN_OVERHEAD_US);
+        else read_bytes(dev, read, size);
+        count_bytes(write != NULL, size);
+    }
+
+    int64_t us = LCD_SIM_TXN_OVERHEAD_US + wire_us(dev, size, err);
+    stats->bus_us += us;
+    lcd_sim_advance_us(us);
+    return err;
+}
+
+static void queue_timer_cb(void *arg);
+
+/**
+ * @brief Starts the queue timer for the oldest queued transfer.
+ */
+static void arm_queue(void) {
+    if(bus.count == 0) return;
+
+    if(bus.timer == NULL) {
+        const esp_timer_create_args_t args = { .callback = queue_timer_cb, .name = "i2c_queue" };
+        if(esp_timer_create(&args, &bus.timer) != ESP_OK) abort();
+    }
+
+    int64_t wait = bus.queue[bus.head].done - lcd_sim_now_us();
+    esp_timer_start_once(bus.timer, wait > 0 ? (uint64_t)wait : 0);
+}
+
+/**
+ * @brief Finishes the queued transfers that are done on the wire, in the order they were queued.
+ */
+static void queue_timer_cb(void *arg) {
+    (void)arg;
+
+    while(bus.count > 0 && bus.queue[bus.head].done <= lcd_sim_now_us()) {
+        sim_transfer_t t = bus.queue[bus.head];
+        bus.head = (bus.head + 1) % SIM_MAX_QUEUE;
+        bus.count--;
+
+        sim_device_t *dev = t.handle->device;
+        if(t.err == ESP_OK && dev != NULL) {
+            if(t.write != NULL) write_bytes(dev, t.write, t.size, t.start);
+            else read_bytes(dev, t.read, t.size);
+        }
+
+        if(t.handle->on_trans_done != NULL) {
+            i2c_master_event_data_t evt = { .event = t.err == ESP_OK ? I2C_EVENT_DONE : I2C_EVENT_NACK };
+            t.handle->on_trans_done(t.handle, &evt, t.handle->user_data);
+        }
+    }
+
+    arm_queue();
+}
+
+static bool queue_has_space(void *ctx) {
+    (void)ctx;
+    return bus.count < bus.queue_depth;
+}
+
+static bool queue_empty(void *ctx) {
+    (void)ctx;
+    return bus.count == 0;
+}
+
+/**
+ * @brief Queues a transaction and returns as soon as it is set up. The buffers are used when
+ * the transfer is done, so they must stay valid until then.
+ */
+static esp_err_t queue_transfer(struct i2c_master_dev_t *handle, const uint8_t *write, uint8_t *read, size_t size) {
+    lcd_sim_stats_t *stats = lcd_sim_stats_mut();
+    sim_device_t *dev = handle->device;
+
+    // Like the ESP-IDF driver, a full queue blocks the caller until a transfer is done
+    lcd_sim_wait(queue_has_space, NULL, -1);
+    lcd_sim_advance_us(LCD_SIM_TXN_OVERHEAD_US);
+
+    sim_transfer_t *t = &bus.queue[(bus.head + bus.count) % SIM_MAX_QUEUE];
+    *t = (sim_transfer_t){ .handle = handle, .write = write, .read = read, .size = size };
+    t->err = take_failure(dev);
+    t->start = bus.free_at > lcd_sim_now_us() ? bus.free_at : lcd_sim_now_us();
+
+    int64_t us = wire_us(dev, size, t->err);
+    t->done = t->start + us;
+    bus.free_at = t->done;
+
+    stats->transactions++;
+    stats->bus_us += LCD_SIM_TXN_OVERHEAD_US + us;
+    if(t->err == ESP_OK) count_bytes(write != NULL, size);
+    if(++bus.count == 1) arm_queue();
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size, int xfer_timeout_ms) {
+    (void)xfer_timeout_ms;
+
+    if(bus.queue_depth > 0) return queue_transfer(i2c_dev, write_buffer, NULL, write_size);
+    return blocking_transfer(i2c_dev->device, write_buffer, NULL, write_size);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms) {
+    (void)xfer_timeout_ms;
+
+    if(bus.queue_depth > 0) return queue_transfer(i2c_dev, NULL, read_buffer, read_size);
+    return blocking_transfer(i2c_dev->device, NULL, read_buffer, read_size);
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_callbacks_t *cbs, void *user_data) {
+    if(bus.queue_depth == 0) return ESP_ERR_INVALID_STATE;
+
+    i2c_dev->on_trans_done = cbs != NULL ? cbs->on_trans_done : NULL;
+    i2c_dev->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus_handle, int timeout_ms) {
+    (void)bus_handle;
+    int64_t deadline = timeout_ms < 0 ? -1 : lcd_sim_now_us() + (int64_t)timeout_ms * 1000;
+
+    return lcd_sim_wait(queue_empty, NULL, deadline) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
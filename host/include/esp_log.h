@@ -0,0 +1,15 @@
+/**
+ * @file:       esp_log.h
+ * @brief:      Host stand-in for ESP-IDF logging, warnings and errors go to stderr.
+ */
+#ifndef HOST_ESP_LOG_H_
+#define HOST_ESP_LOG_H_
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, ...)  (fprintf(stderr, "E %s: ", tag), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGW(tag, ...)  (fprintf(stderr, "W %s: ", tag), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGI(tag, ...)  ((void)(tag))
+#define ESP_LOGD(tag, ...)  ((void)(tag))
+
+#endif
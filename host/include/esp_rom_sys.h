@@ -0,0 +1,12 @@
+/**
+ * @file:       esp_rom_sys.h
+ * @brief:      Host stand-in for the ROM busy-wait, advances the virtual clock.
+ */
+#ifndef HOST_ESP_ROM_SYS_H_
+#define HOST_ESP_ROM_SYS_H_
+
+#include <stdint.h>
+
+void esp_rom_delay_us(uint32_t us);
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file:       event_groups.h
+ * @brief:      Host stand-in for FreeRTOS event groups.
+ */
+#ifndef HOST_EVENT_GROUPS_H_
+#define HOST_EVENT_GROUPS_H_
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct host_event_group *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+void vEventGroupDelete(EventGroupHandle_t group);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_for_all, TickType_t ticks_to_wait);
+
+#endif
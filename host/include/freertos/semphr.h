@@ -0,0 +1,19 @@
+/**
+ * @file:       semphr.h
+ * @brief:      Host stand-in for FreeRTOS semaphores, built on the host queues.
+ */
+#ifndef HOST_SEMPHR_H_
+#define HOST_SEMPHR_H_
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *higher_priority_task_woken);
+
+#endif
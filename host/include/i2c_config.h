@@ -0,0 +1,15 @@
+/**
+ * @file:       i2c_config.h
+ * @brief:      Host stand-in for the project_config component's i2c settings.
+ */
+#ifndef HOST_I2C_CONFIG_H_
+#define HOST_I2C_CONFIG_H_
+
+#define I2C_MASTER_NUM              0
+#define I2C_MASTER_SDA_IO           3
+#define I2C_MASTER_SCL_IO           2
+#define I2C_MASTER_FREQ_HZ          100000
+#define I2C_MASTER_TIMEOUT_MS       1000
+#define I2C_DEVICE_ADDRESS_LEN      I2C_ADDR_BIT_LEN_7
+
+#endif
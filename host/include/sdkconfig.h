@@ -0,0 +1,10 @@
+/**
+ * @file:       sdkconfig.h
+ * @brief:      Host stand-in for the ESP-IDF generated project configuration.
+ */
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+#define CONFIG_FREERTOS_HZ 100
+
+#endif
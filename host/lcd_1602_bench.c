@@ -0,0 +1,392 @@
+/**
+ *
+ * @file:       lcd_1602_bench.c
+ * @brief:      Throughput benchmark of the LCD 1602 driver on the host emulator.
+ * @details
+ * Runs standard workloads against emulated displays and reports i2c transactions, bytes on
+ * the bus, virtual wall time and the resulting screen contents. Exits with 1 if a check fails:
+ * a wrong glyph or marquee on screen, or a timing violation the workload did not provoke.
+ -------------------------------------------------------------------------------------------------*/
+
+#include "lcd_1602.h"
+#include "lcd_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_DISPLAYS  4
+#define BENCH_BARS      5
+#define BENCH_ARROWS    4
+
+/**
+ * @brief Bar graph segments, one to five pixel columns filled.
+ */
+static const lcd_1602_glyph_t bars[BENCH_BARS] = {
+    {{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00 }},
+    {{ 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00 }},
+    {{ 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x00 }},
+    {{ 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x00 }},
+    {{ 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x00 }},
+};
+
+/**
+ * @brief Up, down, left and right arrows.
+ */
+static const lcd_1602_glyph_t arrows[BENCH_ARROWS] = {
+    {{ 0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 }},
+    {{ 0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00 }},
+    {{ 0x00, 0x04, 0x08, 0x1F, 0x08, 0x04, 0x00, 0x00 }},
+    {{ 0x00, 0x04, 0x02, 0x1F, 0x02, 0x04, 0x00, 0x00 }},
+};
+
+static i2c_master_bus_handle_t bus_handle;
+static i2c_master_dev_handle_t dev_handles[BENCH_DISPLAYS];
+static int64_t workload_start;
+static bool violations_expected;
+static uint32_t failures;
+
+/**
+ * @brief Prints why a check failed and counts the failure for the exit status.
+ */
+static void fail(const char *what) {
+    printf("  FAILED: %s\n", what);
+    failures++;
+}
+
+static void begin(void) {
+    lcd_sim_clear_stats();
+    workload_start = lcd_sim_now_us();
+}
+
+/**
+ * @brief Prints one result row and the screen of the display at address. The wall time is
+ * how long the caller was blocked, queued transfers are waited for afterwards. Timing
+ * violations fail the run unless violations_expected is set.
+ */
+static void report(const char *name, uint16_t address) {
+    int64_t wall_us = lcd_sim_now_us() - workload_start;
+    int64_t sleep_us = lcd_sim_stats()->sleep_us;
+
+    for(uint8_t i = 0; i < BENCH_DISPLAYS; i++) lcd_1602_wait_idle(dev_handles[i]);
+
+    const lcd_sim_stats_t *stats = lcd_sim_stats();
+    char rows[2][17];
+    lcd_sim_screen(address, rows);
+
+    printf("%-28s %6u %7u %9lld %9lld %9lld %5u  |%s|%s|\n", name, stats->transactions,
+           stats->bytes_written + stats->bytes_read, (long long)stats->bus_us, (long long)sleep_us,
+           (long long)wall_us, stats->timing_violations, rows[0], rows[1]);
+
+    if(stats->timing_violations > 0 && !violations_expected) fail("the driver broke the LCD timing");
+}
+
+/**
+ * @brief Returns how many of the cells in the second row do not show the expected glyph.
+ */
+static uint8_t glyph_errors(uint16_t address, const lcd_1602_glyph_t *const expected[16]) {
+    const lcd_sim_hd44780_t *lcd = lcd_sim_display(address);
+    uint8_t errors = 0;
+
+    for(uint8_t col = 0; col < 16; col++) {
+        if(expected[col] == NULL) continue;
+
+        uint8_t c = lcd->ddram[1][(col + lcd->shift) % LCD_SIM_DDRAM_COLS];
+        if(c >= 8 || memcmp(&lcd->cgram[c * 8], expected[col]->rows, 8) != 0) errors++;
+    }
+
+    return errors;
+}
+
+/**
+ * @brief Draws a bar graph screen or an arrow screen and checks the glyphs on the emulator.
+ */
+static void glyph_screen(i2c_master_dev_handle_t handle, bool use_bars, bool text, const char *name) {
+    const lcd_1602_glyph_t *expected[16] = { NULL };
+
+    begin();
+    if(use_bars) {
+        if(text) lcd_1602_update(handle, "Level 78 %\n");
+        for(uint8_t col = 0; col < 12; col++) expected[col] = &bars[col < 8 ? BENCH_BARS - 1 : col - 8];
+    }
+    else {
+        if(text) lcd_1602_update(handle, "Heading\n");
+        for(uint8_t i = 0; i < BENCH_ARROWS; i++) expected[i * 3] = &arrows[i];
+    }
+    lcd_1602_put_glyphs(handle, 0, 1, expected, 16);
+    report(name, DEVICE_ADDRESS);
+
+    uint8_t errors = glyph_errors(DEVICE_ADDRESS, expected);
+    if(errors > 0) {
+        printf("  %u cells show the wrong glyph\n", errors);
+        fail(name);
+    }
+}
+
+/**
+ * @brief Returns true if the screen shows the marquee rows scrolled by steps columns.
+ */
+static bool marquee_matches(uint16_t address, const char *const rows[2], uint32_t steps) {
+    char screen[2][17];
+    lcd_sim_screen(address, screen);
+
+    for(uint8_t row = 0; row < 2; row++) {
+        uint32_t len = strlen(rows[row]);
+        uint32_t lap = len <= 40 ? 40 : len + LCD_1602_MARQUEE_GAP;
+
+        for(uint8_t col = 0; col < 16; col++) {
+            uint32_t i = (steps + col) % lap;
+            if(screen[row][col] != (i < len ? rows[row][i] : ' ')) return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief A task that owns a region of the second display and sets it periodically.
+ */
+typedef struct {
+    lcd_1602_region_t region;   /**< Region the task writes */
+    const char *fmt;            /**< Text of the region, formatted with first + the update number */
+    bool clock;                 /**< fmt takes minutes and seconds, the value counts seconds */
+    uint32_t first;             /**< Value shown by the first update */
+    uint32_t updates;           /**< Updates before the task ends */
+    uint32_t period_ms;         /**< Time between updates */
+} producer_t;
+
+static void producer_task(void *arg) {
+    const producer_t *producer = (const producer_t *)arg;
+    char text[LCD_1602_SCREEN_CHAR_WIDTH + 1];
+
+    for(uint32_t i = 0; i < producer->updates; i++) {
+        unsigned value = producer->first + i;
+        if(producer->clock) snprintf(text, sizeof(text), producer->fmt, value / 60, value % 60);
+        else snprintf(text, sizeof(text), producer->fmt, value);
+        lcd_1602_region_set(dev_handles[1], producer->region, text);
+        vTaskDelay(pdMS_TO_TICKS(producer->period_ms));
+    }
+
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Prints the driver's own performance counters for a display.
+ */
+static void print_stats(i2c_master_dev_handle_t handle) {
+    static const char *names[LCD_1602_API_COUNT] = {
+        "init", "send_string", "update", "send_char", "clear_screen", "submit", "flush", "put_glyph", "attach",
+        "page_write", "page_show", "calibrate", "region_set", "region_flush"
+    };
+    lcd_1602_stats_t stats;
+
+    if(lcd_1602_get_stats(handle, &stats, false) != 0) return;
+
+    printf("\ndriver counters for 0x%02X: %u txns, %u bytes sent, %u received, %u errors, %u resyncs, %u glyph uploads, bus %llu us, delay %llu us\n",
+           DEVICE_ADDRESS, stats.transactions, stats.bytes_sent, stats.bytes_received, stats.errors, stats.resyncs, stats.glyph_uploads,
+           (unsigned long long)stats.bus_us, (unsigned long long)stats.delay_us);
+    printf("%-14s %6s %9s %9s\n", "call", "calls", "avg_us", "max_us");
+    for(uint8_t i = 0; i < LCD_1602_API_COUNT; i++) {
+        if(stats.api[i].calls == 0) continue;
+        printf("%-14s %6u %9llu %9u\n", names[i], stats.api[i].calls,
+               (unsigned long long)(stats.api[i].total_us / stats.api[i].calls), stats.api[i].max_us);
+    }
+}
+
+int main(int argc, char **argv) {
+    for(uint8_t i = 0; i < BENCH_DISPLAYS; i++) {
+        if(i2c_open(&bus_handle, &dev_handles[i], DEVICE_ADDRESS - i) != 0) {
+            fprintf(stderr, "i2c_open failed for display %u\n", i);
+            return 1;
+        }
+    }
+
+    i2c_master_dev_handle_t lcd = dev_handles[0];
+
+    printf("i2c transfers: %s\n", I2C_TRANS_QUEUE_DEPTH > 0 ? "queued" : "blocking");
+    printf("%-28s %6s %7s %9s %9s %9s %5s  %s\n", "workload", "txns", "bytes", "bus_us", "sleep_us", "wall_us", "viol", "screen");
+
+    lcd_sim_reset();
+    begin();
+    lcd_1602_init(lcd);
+    report("init", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_send_string(lcd, "Temperature 21.5\nHumidity 45.2 %");
+    report("full redraw (send_string)", DEVICE_ADDRESS);
+
+    // As after a reboot of the MCU only, the text stays on screen
+    begin();
+    lcd_1602_attach(lcd);
+    report("warm attach", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_update(lcd, "Pressure 1013hPa\nWind 4.2 m/s NW");
+    report("full redraw (update)", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_update(lcd, "Pressure 1012hPa\nWind 4.2 m/s NW");
+    report("single-cell update", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_update(lcd, "Pressure 1012hPa\nWind 4.2 m/s NW");
+    report("unchanged update", DEVICE_ADDRESS);
+
+    // A glitch leaves the LCD between nibbles and the transfer reporting it fails once
+    lcd_sim_desync(DEVICE_ADDRESS);
+    lcd_sim_fail_transfers(DEVICE_ADDRESS, 1, ESP_FAIL);
+    begin();
+    lcd_1602_update(lcd, "Pressure 1011hPa\nWind 4.2 m/s NW");
+    report("fault recovery (update)", DEVICE_ADDRESS);
+
+    lcd_1602_set_timing_mode(lcd, LCD_1602_TIMING_BUSY_FLAG);
+    begin();
+    lcd_1602_send_string(lcd, "Temperature 21.5\nHumidity 45.2 %");
+    report("full redraw (busy flag)", DEVICE_ADDRESS);
+    lcd_1602_set_timing_mode(lcd, LCD_1602_TIMING_FIXED);
+
+    // Nine distinct glyphs over two screens, one more than the CGRAM holds
+    glyph_screen(lcd, true, true, "glyphs (bar graph)");
+    glyph_screen(lcd, false, true, "glyphs (switch to arrows)");
+    glyph_screen(lcd, true, true, "glyphs (switch back)");
+    glyph_screen(lcd, true, false, "glyphs (unchanged)");
+
+    // Every display on the shared bus gets a full frame through the render worker
+    begin();
+    for(uint8_t i = 1; i < BENCH_DISPLAYS; i++) lcd_1602_attach(dev_handles[i]);
+    report("cold attach (3 displays)", DEVICE_ADDRESS - 1);
+
+    for(uint8_t i = 0; i < BENCH_DISPLAYS; i++) lcd_1602_render_start(dev_handles[i], 5);
+
+    begin();
+    for(uint8_t i = 0; i < BENCH_DISPLAYS; i++) {
+        char text[40];
+        snprintf(text, sizeof(text), "Display %u\nNode 0x%02X ready", i, DEVICE_ADDRESS - i);
+        lcd_1602_submit(dev_handles[i], text);
+    }
+    for(uint8_t i = 0; i < BENCH_DISPLAYS; i++) lcd_1602_flush(dev_handles[i], portMAX_DELAY);
+    report("4 displays (render worker)", DEVICE_ADDRESS - (BENCH_DISPLAYS - 1));
+
+    // One row fits the DDRAM line, the other needs the entering column refilled
+    const char *const marquee[2] = {
+        "Now playing: Kind of Blue",
+        "So What - Freddie Freeloader - Blue in Green - All Blues",
+    };
+    char marquee_text[128];
+    snprintf(marquee_text, sizeof(marquee_text), "%s\n%s", marquee[0], marquee[1]);
+
+    begin();
+    lcd_1602_marquee_start(lcd, marquee_text, 250);
+    report("marquee load", DEVICE_ADDRESS);
+
+    begin();
+    lcd_sim_run_for_us(100 * 250000 + 1000);
+    report("marquee (100 steps)", DEVICE_ADDRESS);
+    if(!marquee_matches(DEVICE_ADDRESS, marquee, 100)) fail("marquee shows the wrong text");
+    lcd_1602_marquee_stop(lcd);
+
+    // The alarm page is prepared off screen and flipped in without redrawing
+    lcd_1602_page_write(lcd, 0, "Status\nAll systems OK");
+
+    begin();
+    lcd_1602_page_write(lcd, 1, "ALARM\nDoor 3 open");
+    report("page write (hidden)", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_page_show(lcd, 1);
+    report("page show (shift)", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_page_show(lcd, 0);
+    report("page show (home)", DEVICE_ADDRESS);
+
+    // The wiring of the first display only carries 500 kHz, so 400 kHz is kept with its margin
+    uint32_t scl_hz = 0;
+    lcd_sim_set_max_scl(DEVICE_ADDRESS, 500000);
+
+    begin();
+    lcd_1602_calibrate(&dev_handles[0], &scl_hz);
+    lcd = dev_handles[0];
+    report("calibrate", DEVICE_ADDRESS);
+    printf("  calibrated to %lu Hz\n", (unsigned long)scl_hz);
+
+    begin();
+    lcd_1602_update(lcd, "Temperature 21.5\nHumidity 45.2 %");
+    report("full redraw (calibrated)", DEVICE_ADDRESS);
+
+    begin();
+    lcd_1602_calibrate(&dev_handles[0], &scl_hz);
+    lcd = dev_handles[0];
+    report("calibrate (stored speed)", DEVICE_ADDRESS);
+
+    // Three tasks own parts of the second display, the clock is far chattier than it needs to be
+    static producer_t producers[3] = {
+        { .fmt = "12:%02u:%02u", .clock = true, .first = 11, .updates = 50, .period_ms = 20 },
+        { .fmt = "%u.5 C", .first = 21, .updates = 10, .period_ms = 100 },
+        { .fmt = "%u", .first = 1, .updates = 4, .period_ms = 250 },
+    };
+    lcd_1602_region_add(dev_handles[1], 0, 8, 8, 4, &producers[0].region);
+    lcd_1602_region_add(dev_handles[1], 1, 0, 10, 0, &producers[1].region);
+    lcd_1602_region_add(dev_handles[1], 1, 15, 1, 0, &producers[2].region);
+
+    begin();
+    for(uint8_t i = 0; i < 3; i++) xTaskCreate(producer_task, "producer", 2048, &producers[i], 5, NULL);
+    lcd_sim_run_for_us(1100000);
+    report("regions (3 tasks, 64 sets)", DEVICE_ADDRESS - 1);
+
+    // Noise hits a cell on screen and one of the hidden page, the scrub reads 16 cells every 50 ms
+    lcd_1602_scrub_start(lcd, 50, 16);
+
+    begin();
+    lcd_sim_run_for_us(200000);
+    report("scrub (clean, 4 cycles)", DEVICE_ADDRESS);
+
+    lcd_sim_corrupt(DEVICE_ADDRESS, 0, 3, '#');
+    lcd_sim_corrupt(DEVICE_ADDRESS, 1, 20, '#');
+    begin();
+    lcd_sim_run_for_us(200000);
+    report("scrub (2 corrupted cells)", DEVICE_ADDRESS);
+
+    // Until the garbled read gives the desync away, the controller takes the scrub's bytes out of phase
+    lcd_sim_desync(DEVICE_ADDRESS);
+    violations_expected = true;
+    begin();
+    lcd_sim_run_for_us(200000);
+    report("scrub (desynced LCD)", DEVICE_ADDRESS);
+    violations_expected = false;
+
+    // A period shorter than a cycle is raised to the cycle time, so blocking calls still get the display
+    lcd_1602_scrub_start(lcd, 1, 16);
+
+    begin();
+    for(uint8_t i = 0; i < 10; i++) {
+        char text[40];
+        snprintf(text, sizeof(text), "Temperature 21.%u\nHumidity 45.2 %%", i);
+        lcd_1602_send_string(lcd, text);
+        lcd_sim_run_for_us(20000);
+    }
+    report("scrub (1 ms, 10 strings)", DEVICE_ADDRESS);
+    lcd_1602_scrub_stop(lcd);
+
+    lcd_1602_scrub_stats_t scrub;
+    lcd_1602_get_scrub_stats(lcd, &scrub, false);
+    printf("  scrub: %u cycles, %u cells read, %u mismatches, %u repairs, %u resyncs, %u read errors\n",
+           scrub.cycles, scrub.cells_read, scrub.mismatches, scrub.repairs, scrub.resyncs, scrub.read_errors);
+
+    print_stats(lcd);
+
+    // The last transfers of the first display, for lcd_1602_trace_decode
+    if(argc > 1) {
+        static uint8_t dump[LCD_1602_TRACE_DUMP_BYTES];
+        size_t len = lcd_1602_trace_dump(lcd, dump, sizeof(dump));
+        FILE *file = fopen(argv[1], "wb");
+
+        if(file == NULL || fwrite(dump, 1, len, file) != len) fprintf(stderr, "writing the trace to %s failed\n", argv[1]);
+        if(file != NULL) fclose(file);
+    }
+
+    if(failures > 0) {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ *
+ * @file:       lcd_1602_trace_decode.c
+ * @brief:      Turns a trace dump of the LCD 1602 driver back into HD44780 instructions.
+ * @details
+ * Reads a dump written by lcd_1602_trace_dump and prints every transfer with its start time
+ * and the gap to the transfer before it, followed by what the LCD made of the bytes: the
+ * nibbles it latched on the falling edges of E, paired up into instructions, characters and
+ * reads. The nibble phase is followed the way the controller does, so the 8-bit function
+ * sets of an init or a re-synchronization bring the decoder back in step too.
+ *
+ * Usage: lcd_1602_trace_decode dump.bin
+ -------------------------------------------------------------------------------------------------*/
+
+#include "lcd_1602.h"
+#include <stdio.h>
+
+#define PCF_RS      0x01
+#define PCF_RW      0x02
+#define PCF_E       0x04
+
+/**
+ * @brief What the decoder knows about the LCD between bytes.
+ */
+typedef struct {
+    bool eight_bit;         /**< Interface is in 8-bit mode, every E pulse is a full instruction */
+    bool second;            /**< The next nibble is the low half of a byte */
+    uint8_t high;           /**< High nibble latched before */
+    bool high_known;        /**< high was read back, not clocked without a read */
+    uint8_t port;           /**< Last byte written to the expander */
+    uint8_t read;           /**< Last byte read from the expander */
+    bool read_fresh;        /**< read was received since the last falling edge of E */
+} decoder_t;
+
+/**
+ * @brief Prints an instruction written to the LCD.
+ */
+static void print_instruction(uint8_t cmd) {
+    printf("                          ");
+    if(cmd & 0x80) printf("set DDRAM address 0x%02X\n", cmd & 0x7F);
+    else if(cmd & 0x40) printf("set CGRAM address 0x%02X\n", cmd & 0x3F);
+    else if(cmd & 0x20) printf("function set: %s, %s, %s\n", (cmd & 0x10) ? "8-bit" : "4-bit",
+                               (cmd & 0x08) ? "2 lines" : "1 line", (cmd & 0x04) ? "5x10" : "5x8");
+    else if(cmd & 0x10) printf("%s shift %s\n", (cmd & 0x08) ? "display" : "cursor", (cmd & 0x04) ? "right" : "left");
+    else if(cmd & 0x08) printf("display %s, cursor %s, blink %s\n", (cmd & 0x04) ? "on" : "off",
+                               (cmd & 0x02) ? "on" : "off", (cmd & 0x01) ? "on" : "off");
+    else if(cmd & 0x04) printf("entry mode: %s%s\n", (cmd & 0x02) ? "increment" : "decrement", (cmd & 0x01) ? ", shift display" : "");
+    else if(cmd & 0x02) printf("return home\n");
+    else if(cmd & 0x01) printf("clear display\n");
+    else printf("no instruction (0x00)\n");
+}
+
+/**
+ * @brief Handles a byte the LCD took in or gave out.
+ */
+static void decode_byte(decoder_t *d, uint8_t byte, bool rs, bool rw, bool known) {
+    if(rw) {
+        if(!known) printf("                          read %s: low nibble not captured\n", rs ? "data" : "busy flag");
+        else if(rs) printf("                          read data 0x%02X\n", byte);
+        else printf("                          read busy flag %u, address 0x%02X\n", byte >> 7, byte & 0x7F);
+        return;
+    }
+
+    if(rs) {
+        if(byte >= 0x20 && byte < 0x7F) printf("                          write '%c'\n", byte);
+        else printf("                          write 0x%02X\n", byte);
+        return;
+    }
+
+    print_instruction(byte);
+    if((byte & 0xE0) == 0x20) d->eight_bit = (byte & 0x10) != 0;
+}
+
+/**
+ * @brief Follows the E line through a byte written to the expander.
+ */
+static void decode_port(decoder_t *d, uint8_t port) {
+    bool falling = (d->port & PCF_E) && !(port & PCF_E);
+    uint8_t latched = d->port;
+    d->port = port;
+    if(!falling) return;
+
+    bool rs = (latched & PCF_RS) != 0;
+    bool rw = (latched & PCF_RW) != 0;
+    // On a read the LCD drives the data lines, the nibble is what the expander read back
+    uint8_t nibble = (rw ? d->read : latched) >> 4;
+    bool known = !rw || d->read_fresh;
+    d->read_fresh = false;
+
+    if(d->eight_bit) {
+        // D3-D0 are not wired, the LCD sees them low
+        d->second = false;
+        decode_byte(d, nibble << 4, rs, rw, known);
+        return;
+    }
+
+    if(!d->second) {
+        d->high = nibble;
+        d->high_known = known;
+        d->second = true;
+        return;
+    }
+
+    d->second = false;
+    decode_byte(d, (d->high << 4) | nibble, rs, rw, d->high_known && known);
+}
+
+int main(int argc, char **argv) {
+    if(argc != 2) {
+        fprintf(stderr, "usage: %s dump.bin\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if(file == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    lcd_1602_trace_header_t header;
+    if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != LCD_1602_TRACE_MAGIC ||
+       header.version != LCD_1602_TRACE_VERSION || header.entry_bytes != sizeof(lcd_1602_trace_entry_t)) {
+        fprintf(stderr, "%s: not a version %u trace dump\n", argv[1], LCD_1602_TRACE_VERSION);
+        fclose(file);
+        return 1;
+    }
+
+    // Without the start of the trace the LCD is assumed to be running in 4-bit mode, idle between bytes
+    decoder_t d = { .eight_bit = header.first == 0, .port = 0 };
+    uint32_t last_us = 0;
+    bool skipping = true;
+
+    static lcd_1602_trace_entry_t entries[UINT16_MAX];
+    uint32_t count = fread(entries, sizeof(entries[0]), header.count, file);
+    fclose(file);
+
+    printf("%u entries from #%u, LCD assumed in %s mode\n", header.count, header.first, d.eight_bit ? "power-on 8-bit" : "4-bit");
+    printf("%-8s %10s %8s  transfer\n", "entry", "time_us", "gap_us");
+
+    for(uint32_t i = 0; i < count; i++) {
+        const lcd_1602_trace_entry_t entry = entries[i];
+        uint8_t len = entry.info & LCD_1602_TRACE_LEN_MASK;
+
+        // The oldest transfer may have lost its first entries to the ring
+        if(entry.info & LCD_1602_TRACE_CONT) {
+            if(skipping) continue;
+        }
+        else {
+            skipping = false;
+            int32_t gap = i == 0 ? 0 : (int32_t)(entry.time_us - last_us);
+            last_us = entry.time_us;
+
+            printf("#%-7u %10u %+8d  ", header.first + i, entry.time_us, gap);
+            uint32_t bytes = len;
+            for(uint32_t j = i + 1; j < count && (entries[j].info & LCD_1602_TRACE_CONT); j++) {
+                bytes += entries[j].info & LCD_1602_TRACE_LEN_MASK;
+            }
+
+            if(entry.info & LCD_1602_TRACE_DONE) printf("queued transfer finished");
+            else printf("%s %u bytes", (entry.info & LCD_1602_TRACE_READ) ? "read" : "write", bytes);
+            if(entry.result != 0) printf(" FAILED (error %d)", entry.result);
+            printf("\n");
+        }
+
+        // Bytes of failed transfers may or may not have reached the LCD, they are not decoded
+        if(entry.result != 0) continue;
+
+        if(entry.info & LCD_1602_TRACE_READ) {
+            if(len > 0) {
+                d.read = entry.data[len - 1];
+                d.read_fresh = true;
+            }
+            continue;
+        }
+
+        for(uint8_t b = 0; b < len; b++) decode_port(&d, entry.data[b]);
+    }
+
+    return 0;
+}
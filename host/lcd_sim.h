@@ -0,0 +1,161 @@
+/**
+ *
+ * @file:       lcd_sim.h
+ * @brief:      Host-side stand-in for the ESP32 the driver runs on.
+ * @details
+ * The driver is built for Linux against stand-ins for the ESP-IDF and FreeRTOS API:s it uses.
+ * - A virtual clock in microseconds. Bus transfers advance it by the time they take on the
+ *   wire, delays by the time asked for. Nothing waits in real time.
+ * - A cooperative scheduler for FreeRTOS tasks. The program's main function is the first task,
+ *   blocking calls switch to the next task and the clock jumps ahead when every task is waiting.
+ * - An i2c master whose devices are emulated PCF8574 expanders wired to HD44780 controllers
+ *   with DDRAM, CGRAM, address counter, entry mode, display shift and busy timing.
+ -------------------------------------------------------------------------------------------------*/
+
+#ifndef LCD_SIM_H_
+#define LCD_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/i2c_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_SIM_MAX_DEVICES         8       /**< Max emulated displays */
+#define LCD_SIM_DDRAM_COLS          40      /**< DDRAM columns per line */
+#define LCD_SIM_TXN_OVERHEAD_US     20      /**< CPU time the i2c driver spends per transaction besides the wire */
+
+/**
+ * @brief Counters for everything that went over the emulated bus.
+ */
+typedef struct {
+    uint32_t transactions;          /**< i2c transactions, transmit and receive */
+    uint32_t bytes_written;         /**< Data bytes written, address bytes not included */
+    uint32_t bytes_read;            /**< Data bytes read */
+    int64_t bus_us;                 /**< Time spent in transactions */
+    int64_t sleep_us;               /**< Time spent in vTaskDelay, esp_rom_delay_us and blocking waits */
+    uint32_t instructions;          /**< Instructions executed by the emulated controllers */
+    uint32_t data_writes;           /**< Characters written to DDRAM or CGRAM */
+    uint32_t timing_violations;     /**< Writes that reached a controller while it was busy */
+} lcd_sim_stats_t;
+
+/**
+ * @brief The state of an emulated HD44780.
+ */
+typedef struct {
+    bool four_bit;                                  /**< Interface data length */
+    bool two_lines;                                 /**< Display lines */
+    bool display_on;                                /**< Display switch */
+    bool cursor_on;                                 /**< Cursor switch */
+    bool blink;                                     /**< Blink switch */
+    bool increment;                                 /**< Entry mode I/D */
+    bool shift_on_write;                            /**< Entry mode S */
+    bool in_cgram;                                  /**< Address counter points into CGRAM */
+    uint8_t ac;                                     /**< Address counter */
+    uint8_t shift;                                  /**< Display shift in columns to the left */
+    uint8_t ddram[2][LCD_SIM_DDRAM_COLS];           /**< DDRAM, one array per line */
+    uint8_t cgram[64];                              /**< CGRAM, 8 bytes per glyph */
+    uint8_t backlight;                              /**< Backlight pin of the expander */
+} lcd_sim_hd44780_t;
+
+/* Virtual clock -----------------------------------------------------------------------------------*/
+/**
+ * @brief Power cycles every emulated display, forgets all tasks and timers except the caller
+ * and resets the clock and the counters. Device handles stay valid.
+ */
+void lcd_sim_reset(void);
+
+/**
+ * @brief Returns the virtual time in microseconds.
+ */
+int64_t lcd_sim_now_us(void);
+
+/**
+ * @brief Moves the virtual clock forward and fires the timers that expire on the way.
+ */
+void lcd_sim_advance_us(int64_t us);
+
+/**
+ * @brief Returns the counters since the last lcd_sim_clear_stats.
+ */
+const lcd_sim_stats_t *lcd_sim_stats(void);
+
+/**
+ * @brief Zeroes the counters.
+ */
+void lcd_sim_clear_stats(void);
+
+/* Scheduler ---------------------------------------------------------------------------------------*/
+/**
+ * @brief Lets the other tasks run until all of them are waiting, or until the deadline.
+ * 
+ * @param us max virtual time to run, 0 to only run what is ready
+ */
+void lcd_sim_run_for_us(int64_t us);
+
+/**
+ * @brief Blocks the calling task until the condition holds or the deadline passes.
+ * 
+ * @param cond condition to wait for
+ * @param ctx passed to cond
+ * @param deadline_us virtual time to give up at, -1 to wait forever
+ * 
+ * @return true if the condition holds.
+ */
+bool lcd_sim_wait(bool (*cond)(void *ctx), void *ctx, int64_t deadline_us);
+
+/* Emulated displays -------------------------------------------------------------------------------*/
+/**
+ * @brief Returns the controller emulated at an address, NULL if there is no device there.
+ */
+const lcd_sim_hd44780_t *lcd_sim_display(uint16_t address);
+
+/**
+ * @brief Copies the visible characters of a display, taking the display shift into account.
+ * Characters outside the printable ASCII range are shown as '?'.
+ * 
+ * @param address address of the display
+ * @param[out] rows two NUL-terminated rows of 16 characters
+ */
+void lcd_sim_screen(uint16_t address, char rows[2][17]);
+
+/**
+ * @brief Makes the next transfers to a display fail without reaching it.
+ * 
+ * @param address address of the display
+ * @param count transfers to fail
+ * @param err error returned by the failing transfers
+ */
+void lcd_sim_fail_transfers(uint16_t address, uint32_t count, esp_err_t err);
+
+/**
+ * @brief Limits the clock the wiring of a display carries. Above it, D4 flips in every byte
+ * written to or read from the expander, as on a long cable.
+ * 
+ * @param address address of the display
+ * @param hz fastest clean SCL speed, 0 for no limit
+ */
+void lcd_sim_set_max_scl(uint16_t address, uint32_t hz);
+
+/**
+ * @brief Makes a display lose track of which nibble comes next, as after a glitch on E.
+ */
+void lcd_sim_desync(uint16_t address);
+
+/**
+ * @brief Overwrites a DDRAM cell of a display behind the driver's back, as noise on the bus would.
+ * 
+ * @param address address of the display
+ * @param line DDRAM line
+ * @param col column in the DDRAM line
+ * @param value the character the cell ends up with
+ */
+void lcd_sim_corrupt(uint16_t address, uint8_t line, uint8_t col, uint8_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -49,6 +49,41 @@ extern "C" {
 #define DEVICE_ADDRESS  0x27            /**< Device address. Standars is often 0x27 */
 #define LCD_1602_SCREEN_CHAR_WIDTH 16   /**< Max character width of the screen */
 #define LCD_1602_MAX_ROWS 2             /**< Max rows available on the screen */
+#define LCD_1602_GLYPH_ROWS 8           /**< Pixel rows of a custom glyph */
+#define LCD_1602_PAGES (40 / LCD_1602_SCREEN_CHAR_WIDTH)  /**< Pages that fit side by side in the 40 DDRAM columns of a line */
+#define LCD_1602_MARQUEE_MAX_LEN 64     /**< Longest marquee row, rows up to the 40 DDRAM columns scroll without rewriting any character */
+#define LCD_1602_MARQUEE_GAP 4          /**< Blank columns between the end and the start of a marquee row longer than 40 characters */
+#define LCD_1602_MAX_DISPLAYS 8         /**< Max displays the driver keeps state (shadow framebuffer etc.) for */
+#define LCD_1602_MAX_REGIONS 8          /**< Max regions of the screen per display, see lcd_1602_region_add */
+#define LCD_1602_BURST_SETTLE_BYTES 0   /**< Extra E-low bytes after each write in a burst (0-4). Raise above 0 if the bus runs faster than 400 kHz */
+#define LCD_1602_CALIBRATE_SPEEDS { 100000, 400000, 1000000 }    /**< SCL speeds lcd_1602_calibrate tries, slowest first */
+#define LCD_1602_CALIBRATE_MARGIN_PCT 10   /**< A speed is only kept if it also works this much faster */
+#define LCD_1602_CALIBRATE_PASSES 3     /**< Test patterns written and read back per speed */
+
+#ifndef LCD_1602_ENABLE_STATS
+#define LCD_1602_ENABLE_STATS 0         /**< Set to 1 to collect per display performance counters, see lcd_1602_get_stats */
+#endif
+#define LCD_1602_STATS_BUCKETS 20       /**< Latency histogram buckets, bucket n counts calls taking [2^(n-1), 2^n) us */
+#define LCD_1602_STATS_ERROR_CODES 4    /**< Distinct esp_err_t codes counted per display */
+
+#ifndef LCD_1602_ENABLE_TRACE
+#define LCD_1602_ENABLE_TRACE 0         /**< Set to 1 to record every i2c transfer of a display, see lcd_1602_trace_dump */
+#endif
+#define LCD_1602_TRACE_ENTRIES 128      /**< Entries in the trace ring of each display, a power of two up to 128 */
+#define LCD_1602_TRACE_DATA_BYTES 8     /**< Bytes of a transfer kept per trace entry, longer transfers take several entries */
+
+#ifndef LCD_1602_ENABLE_PAGES
+#define LCD_1602_ENABLE_PAGES 1         /**< Set to 0 to leave out the hidden pages and their buffers, see lcd_1602_page_write */
+#endif
+#ifndef LCD_1602_ENABLE_REGIONS
+#define LCD_1602_ENABLE_REGIONS 1       /**< Set to 0 to leave out the screen regions and their buffers, see lcd_1602_region_add */
+#endif
+#ifndef LCD_1602_ENABLE_SCRUB
+#define LCD_1602_ENABLE_SCRUB 1         /**< Set to 0 to leave out the DDRAM scrub, see lcd_1602_scrub_start */
+#endif
+#ifndef LCD_1602_ENABLE_MARQUEE
+#define LCD_1602_ENABLE_MARQUEE 1       /**< Set to 0 to leave out the marquee and its buffers, see lcd_1602_marquee_start */
+#endif
 /**@} */
 
 
@@ -59,9 +94,157 @@ typedef enum LCD_WRITE_STATUS{
     LCD_WRITE_FINISHED,
     LCD_WRITE_NOT_FINISHED,
     LCD_WRITE_INTERRUPTED,
-    LCD_TOO_LONG_STRING
+    LCD_TOO_LONG_STRING,
+    LCD_WRITE_ERROR
 } LCD_WRITE_STATUS;
 
+/**
+ * @brief How the driver waits for the LCD to finish an instruction.
+ */
+typedef enum LCD_1602_TIMING_MODE{
+    LCD_1602_TIMING_FIXED,          /**< Worst case delays from the datasheet */
+    LCD_1602_TIMING_BUSY_FLAG       /**< Poll the busy flag, needs R/W connected to the PCF8574 */
+} LCD_1602_TIMING_MODE;
+
+/**
+ * @brief Instruction timings of the LCD in microseconds.
+ */
+typedef struct {
+    uint32_t power_on_us;           /**< From power on until the first instruction */
+    uint32_t reset_us;              /**< After the first 8-bit reset nibble */
+    uint32_t reset_short_us;        /**< After the second 8-bit reset nibble */
+    uint32_t clear_us;              /**< Clear display */
+    uint32_t home_us;               /**< Return home */
+    uint32_t instr_us;              /**< Every other instruction and data write */
+} lcd_1602_timing_t;
+
+/**
+ * @brief Default timing profile, the datasheet values with 50 % margin for slow oscillators.
+ */
+#define LCD_1602_TIMING_DEFAULT {       \
+    .power_on_us = 15000,               \
+    .reset_us = 4100,                   \
+    .reset_short_us = 100,              \
+    .clear_us = 2300,                   \
+    .home_us = 2300,                    \
+    .instr_us = 56,                     \
+}
+
+/**
+ * @brief A custom 5x8 character. Kept by reference while it is on screen, so it should
+ * outlive its use (e.g. a static const).
+ */
+typedef struct {
+    uint8_t rows[LCD_1602_GLYPH_ROWS];                      /**< Pixel rows from the top, bit 4 is the leftmost pixel */
+} lcd_1602_glyph_t;
+
+/**
+ * @brief Called from the i2c driver's interrupt when the bus has finished every transfer
+ * queued for a display.
+ */
+typedef void (*lcd_1602_done_cb_t)(i2c_master_dev_handle_t handle, void *arg);
+
+/**
+ * @brief Public calls that are timed by the performance counters.
+ */
+typedef enum LCD_1602_API{
+    LCD_1602_API_INIT,
+    LCD_1602_API_SEND_STRING,
+    LCD_1602_API_UPDATE,
+    LCD_1602_API_SEND_CHAR,
+    LCD_1602_API_CLEAR_SCREEN,
+    LCD_1602_API_SUBMIT,
+    LCD_1602_API_FLUSH,
+    LCD_1602_API_PUT_GLYPH,
+    LCD_1602_API_ATTACH,
+    LCD_1602_API_PAGE_WRITE,
+    LCD_1602_API_PAGE_SHOW,
+    LCD_1602_API_CALIBRATE,
+    LCD_1602_API_REGION_SET,
+    LCD_1602_API_REGION_FLUSH,
+    LCD_1602_API_COUNT
+} LCD_1602_API;
+
+/**
+ * @brief Performance counters of a display.
+ */
+typedef struct {
+    uint32_t transactions;                                  /**< i2c transactions */
+    uint32_t bytes_sent;                                    /**< Bytes written to the expander */
+    uint32_t bytes_received;                                /**< Bytes read from the expander */
+    uint32_t errors;                                        /**< Failed i2c transactions */
+    struct {
+        esp_err_t code;                                     /**< Error code, ESP_OK for an unused slot */
+        uint32_t count;                                     /**< Transactions that failed with the code */
+    } error_codes[LCD_1602_STATS_ERROR_CODES];              /**< Failed transactions by error code, the last slot also counts codes that did not fit */
+    uint32_t resyncs;                                       /**< Re-synchronizations after failed transfers */
+    uint32_t glyph_uploads;                                 /**< Glyphs written to the CGRAM */
+    uint64_t bus_us;                                        /**< Time spent in i2c transactions */
+    uint64_t delay_us;                                      /**< Time spent waiting for the LCD */
+    struct {
+        uint32_t calls;                                     /**< Calls made */
+        uint64_t total_us;                                  /**< Time spent in the calls */
+        uint32_t max_us;                                    /**< Slowest call */
+        uint32_t histogram[LCD_1602_STATS_BUCKETS];         /**< Calls by log2 of their latency in us */
+    } api[LCD_1602_API_COUNT];                              /**< Latency of the public calls */
+} lcd_1602_stats_t;
+
+/**
+ * @brief Counters of the DDRAM scrub of a display, see lcd_1602_scrub_start.
+ */
+typedef struct {
+    uint32_t cycles;                                        /**< Scrub cycles run */
+    uint32_t cells_read;                                    /**< Cells read back from the DDRAM */
+    uint32_t mismatches;                                    /**< Cells that differed from what the driver wrote */
+    uint32_t repairs;                                       /**< Cells rewritten one by one */
+    uint32_t resyncs;                                       /**< Reads so garbled that the LCD was re-synchronized instead */
+    uint32_t read_errors;                                   /**< Cycles cut short by a failed read */
+} lcd_1602_scrub_stats_t;
+
+/**
+ * @brief A part of one row of the screen, see lcd_1602_region_add.
+ */
+typedef uint8_t lcd_1602_region_t;
+
+/**
+ * @brief Flags in the high nibble of lcd_1602_trace_entry_t.info
+ * @{
+ */
+#define LCD_1602_TRACE_READ     0x10    /**< Bytes read from the expander, else written to it */
+#define LCD_1602_TRACE_CONT     0x20    /**< Continues the transfer of the entry before */
+#define LCD_1602_TRACE_DONE     0x40    /**< A queued transfer the bus finished with result, carries no data */
+#define LCD_1602_TRACE_LEN_MASK 0x0F    /**< Bytes used in data */
+/**@} */
+
+#define LCD_1602_TRACE_MAGIC    0x5444434C  /**< "LCDT" in the first bytes of a dump */
+#define LCD_1602_TRACE_VERSION  1           /**< Version of the dump format */
+
+/**
+ * @brief One entry of the trace ring. The data bytes are the PCF8574 port: D7-D4 in the high
+ * nibble, then backlight, E, R/W and RS in bits 3 to 0.
+ */
+typedef struct {
+    uint32_t time_us;                                       /**< When the transfer started (queued with I2C_TRANS_QUEUE_DEPTH set), low bits of esp_timer_get_time */
+    int16_t result;                                         /**< esp_err_t of the transfer */
+    uint8_t info;                                           /**< Bytes used in data and LCD_1602_TRACE_* flags */
+    uint8_t seq;                                            /**< Low bits of the entry number, tells a finished entry from one being written */
+    uint8_t data[LCD_1602_TRACE_DATA_BYTES];                /**< Bytes of the transfer */
+} lcd_1602_trace_entry_t;
+
+/**
+ * @brief Start of a trace dump, followed by count entries, oldest first. Fields are in the
+ * byte order of the MCU, little endian on the ESP32.
+ */
+typedef struct {
+    uint32_t magic;                                         /**< LCD_1602_TRACE_MAGIC */
+    uint8_t version;                                        /**< LCD_1602_TRACE_VERSION */
+    uint8_t entry_bytes;                                    /**< sizeof(lcd_1602_trace_entry_t) */
+    uint16_t count;                                         /**< Entries in the dump */
+    uint32_t first;                                         /**< Number of the first entry, 0 if nothing was overwritten since the display was opened */
+} lcd_1602_trace_header_t;
+
+#define LCD_1602_TRACE_DUMP_BYTES (sizeof(lcd_1602_trace_header_t) + LCD_1602_TRACE_ENTRIES * sizeof(lcd_1602_trace_entry_t))  /**< Size of a dump of the full ring */
+
 /**
  * @brief External functions for LCD 1602 API.
  * @defgroup external_functions External Functions
@@ -74,7 +257,8 @@ typedef enum LCD_WRITE_STATUS{
  * @param handle The device handle used to writing on the i2c bus
  * @param str The string to be written to the LCD
  * 
- * @return LCD_WRITE_FINISHED for successful. LCD_WRITE_INTERRUPTED if string is too long for screen.
+ * @return LCD_WRITE_FINISHED for successful. LCD_WRITE_INTERRUPTED if string is too long for screen
+ * or a marquee is running. LCD_WRITE_ERROR if the bus failed and the display could not be recovered.
  */
 LCD_WRITE_STATUS lcd_1602_send_string(i2c_master_dev_handle_t handle, char *str);
 
@@ -87,6 +271,340 @@ LCD_WRITE_STATUS lcd_1602_send_string(i2c_master_dev_handle_t handle, char *str)
  */
 uint8_t lcd_1602_init(i2c_master_dev_handle_t handle);
 
+/**
+ * @brief Attaches to an LCD that may already be running, e.g. set up by a bootloader. If the
+ * controller reads back as being in 4-bit mode only the configuration is sent and the screen
+ * is left as it is apart from a display shift, which a return home undoes. Otherwise this
+ * falls back to lcd_1602_init. Needs R/W wired to the expander to detect a running controller.
+ * 
+ * @param handle The device handle use to writing on the i2c bus
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_attach(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Brings the LCD up to date with the string by only sending the cells that differ from
+ * what the driver last wrote. Uses the same layout rules as lcd_1602_send_string but never clears
+ * the screen, so there is no flicker and a changed counter costs a few bytes on the bus.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param str The string to be shown on the LCD
+ * 
+ * @return LCD_WRITE_FINISHED for successful. LCD_WRITE_INTERRUPTED if string is too long for screen
+ * or a marquee is running. LCD_WRITE_NOT_FINISHED if more than LCD_1602_MAX_DISPLAYS displays are in use.
+ * LCD_WRITE_ERROR if the bus failed and the display could not be recovered.
+ */
+LCD_WRITE_STATUS lcd_1602_update(i2c_master_dev_handle_t handle, const char *str);
+
+/**
+ * @brief Starts a driver owned task that draws submitted frames with lcd_1602_update.
+ * The blocking calls can still be used on the display: each of them holds a lock of the
+ * display until it returns and the task leaves the display alone meanwhile. A frame
+ * submitted before a blocking call may still be drawn after it, latest submission wins.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param priority FreeRTOS priority of the render task
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_render_start(i2c_master_dev_handle_t handle, UBaseType_t priority);
+
+/**
+ * @brief Copies the string and hands it to the render task without blocking on the bus.
+ * If the render task is busy, only the newest submitted string is drawn next. Regions that
+ * have been drawn keep their cells, see lcd_1602_region_add.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param str The string to be shown on the LCD
+ * 
+ * @return LCD_WRITE_NOT_FINISHED when queued. LCD_TOO_LONG_STRING if the string can not fit in a frame.
+ * LCD_WRITE_INTERRUPTED if the render task is not started or a marquee is running.
+ */
+LCD_WRITE_STATUS lcd_1602_submit(i2c_master_dev_handle_t handle, const char *str);
+
+/**
+ * @brief Waits until everything submitted before the call has been drawn.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param timeout max ticks to wait, portMAX_DELAY to wait forever
+ * 
+ * @return 0 for success or 1 on timeout.
+ */
+uint8_t lcd_1602_flush(i2c_master_dev_handle_t handle, TickType_t timeout);
+
+/**
+ * @brief Waits until the bus has sent everything queued for the display. Only needed when
+ * I2C_TRANS_QUEUE_DEPTH is above 0, where calls return while their transfers are still on the
+ * bus. A transfer that failed in the background is repaired with a re-synchronization.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * 
+ * @return 0 if the display shows what the driver last wrote or 1 for fail.
+ */
+uint8_t lcd_1602_wait_idle(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Sets the callback called when the bus has finished every transfer queued for the
+ * display, so the next update can be prepared while the current one is being sent.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param cb callback, called from interrupt context, NULL to remove it
+ * @param arg passed to cb
+ * 
+ * @return 0 for success or 1 if transfers are not queued (I2C_TRANS_QUEUE_DEPTH is 0).
+ */
+uint8_t lcd_1602_set_done_callback(i2c_master_dev_handle_t handle, lcd_1602_done_cb_t cb, void *arg);
+
+/**
+ * @brief Selects how the driver waits for the LCD to finish instructions. In busy flag mode the
+ * driver continues as soon as the LCD is ready and falls back to the fixed delays if the
+ * busy flag can not be read. Only waits at least LCD_1602_BUSY_POLL_MIN_READS busy flag reads
+ * long are polled, so at 100 kHz, where a read takes about 0.8 ms, every wait stays fixed.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param mode LCD_1602_TIMING_FIXED | LCD_1602_TIMING_BUSY_FLAG
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_set_timing_mode(i2c_master_dev_handle_t handle, LCD_1602_TIMING_MODE mode);
+
+/**
+ * @brief Sets the timing profile for the display. Waits are done with microsecond resolution
+ * and do not depend on the FreeRTOS tick rate.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param timing the profile to copy, see LCD_1602_TIMING_DEFAULT
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_set_timing(i2c_master_dev_handle_t handle, const lcd_1602_timing_t *timing);
+
+/**
+ * @brief Copies the performance counters of the display. Only available when
+ * LCD_1602_ENABLE_STATS is set. The bus counters and the latency of each call are copied one
+ * group at a time, so the i2c interrupt is never held off for the whole struct; a call that
+ * returns during the copy may be counted in some groups only.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param[out] stats the counters
+ * @param reset zero the counters after copying them
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_get_stats(i2c_master_dev_handle_t handle, lcd_1602_stats_t *stats, bool reset);
+
+/**
+ * @brief Copies the trace ring of the display into a dump, see lcd_1602_trace_header_t and
+ * host/lcd_1602_trace_decode.c. Only available when LCD_1602_ENABLE_TRACE is set. Transfers
+ * may go on while dumping, entries that are being written are left out.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param[out] buf where the dump is written, LCD_1602_TRACE_DUMP_BYTES holds the full ring
+ * @param size bytes available in buf, the newest entries that fit are dumped
+ * 
+ * @return bytes written to buf, 0 for fail.
+ */
+size_t lcd_1602_trace_dump(i2c_master_dev_handle_t handle, void *buf, size_t size);
+
+/**
+ * @brief Shows a custom glyph in a cell. The driver keeps the 8 CGRAM slots as a cache and
+ * only uploads the glyph if it is not already in one, evicting the least recently used slot
+ * otherwise. Cells still showing an evicted glyph are blanked and redrawn once the glyph is
+ * put again. Text written over a cell releases its glyph.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param x column on the device
+ * @param y row on the device
+ * @param glyph the glyph to show, must stay valid while it is on screen
+ * 
+ * @return 0 for success or 1 for fail or while a marquee is running.
+ */
+uint8_t lcd_1602_put_glyph(i2c_master_dev_handle_t handle, uint8_t x, uint8_t y, const lcd_1602_glyph_t *glyph);
+
+/**
+ * @brief Shows a run of glyphs starting at a cell, sent as one transaction when it fits. Glyphs
+ * of the run never evict each other, so a screen using up to 8 glyphs only uploads the ones
+ * that are missing.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param x column of the first glyph
+ * @param y row on the device
+ * @param glyphs the glyphs, a NULL entry leaves its cell as it is
+ * @param count number of glyphs
+ * 
+ * @return 0 for success or 1 for fail or while a marquee is running.
+ */
+uint8_t lcd_1602_put_glyphs(i2c_master_dev_handle_t handle, uint8_t x, uint8_t y, const lcd_1602_glyph_t *const glyphs[], uint8_t count);
+
+/**
+ * @brief Writes a page. Pages live side by side in the DDRAM lines, only the one on screen is
+ * visible, so a hidden page can be prepared without touching what is shown. Writing the page
+ * on screen is the same as lcd_1602_update. Only cells that differ are sent. The page calls
+ * are only available when LCD_1602_ENABLE_PAGES is set.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param page the page, below LCD_1602_PAGES
+ * @param str the content, laid out like lcd_1602_send_string
+ * 
+ * @return the same as lcd_1602_update. LCD_WRITE_NOT_FINISHED if page is out of range or a marquee is running.
+ */
+LCD_WRITE_STATUS lcd_1602_page_write(i2c_master_dev_handle_t handle, uint8_t page, const char *str);
+
+/**
+ * @brief Brings a page on screen. Page 0 is shown with a single cursor home instruction,
+ * other pages with one display shift per column between the pages, sent as one burst. The
+ * display stays on, so the shifts are seen as a fast scroll: at 100 kHz the 16 shifts to
+ * page 1 take about 5.9 ms. The text calls draw on the page on screen.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param page the page, below LCD_1602_PAGES
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_page_show(i2c_master_dev_handle_t handle, uint8_t page);
+
+/**
+ * @brief Registers a region of the screen that a task can update on its own with
+ * lcd_1602_region_set. Regions may not overlap. Once drawn, a region keeps its cells: frames
+ * from lcd_1602_submit are drawn around it, the blocking text calls write over it until the
+ * region is set again. The region calls are only available when LCD_1602_ENABLE_REGIONS is set.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param row row of the region
+ * @param col first column of the region
+ * @param width columns of the region
+ * @param max_hz most redraws of the region per second, 0 for no limit. Updates in between
+ * are merged and the newest is drawn when the region is due
+ * @param[out] region the region
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_region_add(i2c_master_dev_handle_t handle, uint8_t row, uint8_t col, uint8_t width, uint32_t max_hz, lcd_1602_region_t *region);
+
+/**
+ * @brief Sets the text of a region without blocking or locking, so tasks can update their
+ * own regions at the same time. Text shorter than the region is padded with spaces. The
+ * render task draws every changed region in one pass, see lcd_1602_render_start, otherwise
+ * call lcd_1602_region_flush. Each region must only be set from one task at a time.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param region region from lcd_1602_region_add
+ * @param str the text
+ * 
+ * @return LCD_WRITE_NOT_FINISHED as the text is drawn later, LCD_TOO_LONG_STRING if it was cut
+ * to the region, LCD_WRITE_INTERRUPTED for an unknown region.
+ */
+LCD_WRITE_STATUS lcd_1602_region_set(i2c_master_dev_handle_t handle, lcd_1602_region_t region, const char *str);
+
+/**
+ * @brief Draws the regions changed since the last flush that are due by their max_hz. The
+ * changes of each row are sent as one burst, with cursor moves only between changed spans.
+ * Only for displays without a render task, which does this by itself.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_region_flush(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Starts checking the DDRAM in the background. Every period the render task reads
+ * up to max_cells cells back, walking through the visible screen and the hidden pages, and
+ * rewrites the cells that differ from what the driver wrote. When most cells of a read
+ * differ, the LCD is taken to be between nibbles and is re-synchronized instead. Scrubbing
+ * only runs when the render task has nothing else to draw and pauses during a marquee. A
+ * cycle holds the lock of the display, so blocking calls wait for it and it waits for them.
+ * Needs the R/W line of the LCD wired to the PCF8574. The scrub calls are only available when
+ * LCD_1602_ENABLE_SCRUB is set.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param period_ms time between scrub cycles, raised to the longest a cycle can take at the
+ * speed of the display. Ticks that come while a cycle runs are skipped
+ * @param max_cells cells read per cycle, each costs five i2c transactions of one byte
+ * 
+ * @return 0 for success or 1 for fail, also if the render task is not started.
+ */
+uint8_t lcd_1602_scrub_start(i2c_master_dev_handle_t handle, uint32_t period_ms, uint8_t max_cells);
+
+/**
+ * @brief Stops the DDRAM scrub. The counters are kept.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_scrub_stop(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Copies the counters of the DDRAM scrub. A panel that keeps needing repairs is
+ * likely to fail.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param[out] stats the counters
+ * @param reset zero the counters after copying them
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_get_scrub_stats(i2c_master_dev_handle_t handle, lcd_1602_scrub_stats_t *stats, bool reset);
+
+/**
+ * @brief Scrolls text to the left with the display shift instruction. Every row is loaded
+ * into its 40 column DDRAM line once, after that a step is a single shift instruction. Rows
+ * longer than 40 characters get the column scrolling into view rewritten in the same step.
+ * The LCD shifts all rows together, so the marquee takes the whole display until it is
+ * stopped: the calls that write the screen fail meanwhile and submitted frames are drawn
+ * after lcd_1602_marquee_stop. Steps are taken by the render task, see lcd_1602_render_start.
+ * Only available when LCD_1602_ENABLE_MARQUEE is set, like lcd_1602_marquee_stop.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * @param str the rows of the marquee separated by \n, each up to LCD_1602_MARQUEE_MAX_LEN characters
+ * @param step_ms time between steps
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_marquee_start(i2c_master_dev_handle_t handle, const char *str, uint32_t step_ms);
+
+/**
+ * @brief Stops the marquee and clears the display.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_marquee_stop(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Brings the LCD back into 4-bit mode from any nibble phase and rewrites what the
+ * driver last wrote, without clearing the display. The driver does this by itself after a
+ * failed transfer, call it directly if the display shows garbage for other reasons.
+ * 
+ * @param handle The device handle used to writing on the i2c bus
+ * 
+ * @return 0 for success or 1 for fail.
+ */
+uint8_t lcd_1602_resync(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Finds the fastest SCL speed the wiring of a display carries. Each speed of
+ * LCD_1602_CALIBRATE_SPEEDS is tried LCD_1602_CALIBRATE_MARGIN_PCT faster than it is, by
+ * writing test patterns to an unused part of the DDRAM and reading them back. The highest
+ * speed that passes is kept. Speeds at which a burst would outrun the LCD are not tried,
+ * raise LCD_1602_BURST_SETTLE_BYTES to allow them. Changing the speed adds the device to the
+ * bus again, so the handle changes. Calls on the display from other tasks wait until it is
+ * done but must use the new handle afterwards, so call it right after lcd_1602_init or
+ * lcd_1602_attach. Should the i2c driver fail to add the device back at any speed, every
+ * later call on the display fails and the device has to be opened again.
+ * 
+ * @param[in,out] handle The device handle used to writing on the i2c bus, replaced by the new handle
+ * @param[in,out] scl_hz a speed from an earlier calibration or 0. A stored speed is only
+ * verified, the full calibration runs if it is 0 or fails. Set to the speed in use on return,
+ * store it (e.g. in NVS) to skip the calibration on the next boot
+ * 
+ * @return 0 for success or 1 if no speed passed and the display runs at I2C_MASTER_FREQ_HZ.
+ */
+uint8_t lcd_1602_calibrate(i2c_master_dev_handle_t *handle, uint32_t *scl_hz);
+
 uint8_t lcd_1602_send_char(i2c_master_dev_handle_t handle, char c);
 
 uint8_t lcd_1602_clear_screen(i2c_master_dev_handle_t handle);
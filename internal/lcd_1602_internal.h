@@ -21,6 +21,11 @@ extern "C" {
 #include "../include/lcd_1602.h"
 #include <stdint.h>
 #include <stdlib.h>
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 
 /* Exported defines ------------------------------------------------------------------------------*/
 /** @defgroup lcd_1602_defines Internal Defines
@@ -28,6 +33,8 @@ extern "C" {
  *  @{ */
 #define LCD_1602_CLEAR_SCREEN           0x01        /**< Clear screen and sets cursor position to 0*/
 #define LCD_1602_RESET_CURSOR_POS       0x02        /**< Resets the cursor position without changing the content*/
+#define LCD_1602_SET_CGRAM_ADDR         0x40        /**< Sets the CGRAM address, OR with the address */
+#define LCD_1602_SET_DDRAM_ADDR         0x80        /**< Sets the DDRAM address, OR with the address */
 
 #define LCD_1602_INPUT_SET_MASK         0x07        /**< Bitmask for configuring input settings*/
 #define LCD_1602_INPUT_SET              0x04        /**< Flag for configuring input settings */
@@ -64,10 +71,549 @@ extern "C" {
 #define LCD_1602_BACKLIGHT              0x08
 #define LCD_1602_ENABLE                 0x04
 #define LCD_1602_WRITE_DATA             0x00
+#define LCD_1602_RW                     0x02        /**< Read from the LCD when set */
 #define LCD_1602_RS                     0x01
+#define LCD_1602_BUSY_FLAG              0x80        /**< Busy flag bit when reading the instruction register */
+#define LCD_1602_SPIN_MAX_US            200         /**< Waits up to this long are busy-waited, longer waits sleep on a timer */
+#define LCD_1602_BUSY_POLL_MAX          100         /**< Busy flag reads before giving up and using the fixed delay */
+#define LCD_1602_BUSY_READ_BYTES        9           /**< Bytes on the bus for one busy flag read, addresses included */
+#define LCD_1602_BUSY_POLL_MIN_READS    4           /**< Waits shorter than this many busy flag reads use the fixed delay */
+
+#define LCD_1602_BURST_BYTES_PER_WRITE  (4 + LCD_1602_BURST_SETTLE_BYTES)      /**< PCF8574 bytes needed to clock one full byte into the LCD */
+#define LCD_1602_BURST_MAX_WRITES       (LCD_1602_SCREEN_CHAR_WIDTH + 1)        /**< One address command and a full row */
+#define LCD_1602_ALL_ROWS               ((1 << LCD_1602_MAX_ROWS) - 1)        /**< Bitmask with every row set */
+#define LCD_1602_DDRAM_COLS             40          /**< DDRAM columns per line, the screen shows LCD_1602_SCREEN_CHAR_WIDTH of them */
+#define LCD_1602_CURSOR_UNKNOWN         0xFF        /**< The DDRAM address of the LCD is not known */
+#define LCD_1602_SPAN_MERGE_GAP         1           /**< Unchanged cells that are rewritten rather than jumped over, a jump costs as much as one cell */
+
+#define LCD_1602_FRAME_TEXT_LEN         (LCD_1602_MAX_ROWS * (LCD_1602_SCREEN_CHAR_WIDTH + 1) + 1)     /**< Longest submitted text incl. newlines and terminator */
+#define LCD_1602_GLYPH_SLOTS            8           /**< Custom characters the CGRAM holds, shown with character codes 0-7 */
+#define LCD_1602_GLYPH_NONE             0xFF        /**< No CGRAM slot */
+#define LCD_1602_GLYPH_FALLBACK         ' '         /**< Shown in cells whose glyph was evicted until it is uploaded again */
+#define LCD_1602_INIT_STEP_BYTES        (3 * LCD_1602_BURST_BYTES_PER_WRITE)   /**< Longest step of the init table */
+#define LCD_1602_ATTACH_PROBE_ADDR      0x65        /**< DDRAM address written and read back to detect a running 4-bit controller */
+#define LCD_1602_CALIBRATE_LEN          8           /**< Bytes of the calibration test pattern */
+#define LCD_1602_CALIBRATE_COL          (LCD_1602_DDRAM_COLS - LCD_1602_CALIBRATE_LEN)  /**< DDRAM column of line 1 the test pattern is written to */
+#define LCD_1602_BUS_RETRIES            2           /**< Times a failed transfer is retried after resetting the bus */
+#define LCD_1602_ASYNC                  (I2C_TRANS_QUEUE_DEPTH > 0)             /**< Transfers are queued and sent in the background */
+#define LCD_1602_TX_BUF_BYTES           (LCD_1602_BURST_MAX_WRITES * LCD_1602_BURST_BYTES_PER_WRITE)   /**< Longest transfer the driver sends */
+
+#define LCD_1602_RENDER_STACK_SIZE      3072        /**< Stack size of the render task */
+#define LCD_1602_RENDER_DONE_BIT        (1 << 0)    /**< Event bit set while every submitted frame has been drawn */
+#define LCD_1602_REGION_FRESH           0x80        /**< Set in lcd_1602_region_state_t.latest when it holds text the drawer has not taken */
+#define LCD_1602_SCRUB_DESYNC_PCT       50          /**< Share of differing cells in one read that is taken as the LCD being between nibbles */
+#define LCD_1602_SCRUB_DESYNC_MIN       4           /**< Fewest cells a read needs before it can be taken as a desync */
+
+#if LCD_1602_ENABLE_PAGES
+#define LCD_1602_PAGES_KEPT             LCD_1602_PAGES          /**< Pages whose content the driver keeps */
+#else
+#define LCD_1602_PAGES_KEPT             1
+#endif
 
 /** @} lcd_1602_defines */
 
+/* Exported types --------------------------------------------------------------------------------*/
+/**
+ * @brief A run of commands and characters encoded as one contiguous PCF8574 byte stream.
+ * 
+ * Every byte written to the LCD expands into E-high/E-low for both nibbles. At 100-400 kHz
+ * the bus itself spaces the enable pulses further apart than the 37 us the HD44780 needs for
+ * a regular instruction, so a whole row can be clocked out in a single i2c transaction.
+ */
+typedef struct {
+    uint8_t buf[LCD_1602_TX_BUF_BYTES];                                        /**< Encoded PCF8574 bytes */
+    size_t len;                                                                 /**< Bytes used in buf */
+} lcd_1602_burst_t;
+
+/**
+ * @brief Which wait of the timing profile follows a step of the init table.
+ */
+typedef enum LCD_1602_INIT_WAIT{
+    LCD_1602_INIT_WAIT_RESET,
+    LCD_1602_INIT_WAIT_RESET_SHORT,
+    LCD_1602_INIT_WAIT_INSTR,
+    LCD_1602_INIT_WAIT_CLEAR
+} LCD_1602_INIT_WAIT;
+
+/**
+ * @brief A step of the init sequence as ready-made PCF8574 bytes. Steps followed by a regular
+ * instruction wait are chained into one burst, the bus spaces them far enough apart.
+ */
+typedef struct {
+    uint8_t bytes[LCD_1602_INIT_STEP_BYTES];                                /**< Encoded PCF8574 bytes */
+    uint8_t len;                                                            /**< Bytes used in bytes */
+    LCD_1602_INIT_WAIT wait;                                                /**< Minimum wait after the step */
+} lcd_1602_init_step_t;
+
+/**
+ * @brief A frame submitted to the render task.
+ */
+typedef struct {
+    uint32_t seq;                                                           /**< Submission number of the frame */
+    char text[LCD_1602_FRAME_TEXT_LEN];                                     /**< Copy of the submitted text */
+} lcd_1602_frame_t;
+
+/**
+ * @brief A region of the screen. The text is triple buffered: the writer fills back and
+ * swaps it with latest, the drawer swaps front with latest when LCD_1602_REGION_FRESH is set,
+ * so neither side ever waits for the other.
+ */
+typedef struct {
+    uint8_t row;                                                            /**< Row of the region */
+    uint8_t col;                                                            /**< First column of the region */
+    uint8_t width;                                                          /**< Columns of the region */
+    uint32_t min_us;                                                        /**< Shortest time between two redraws, 0 for no limit */
+    int64_t drawn_us;                                                       /**< When the region was last drawn */
+    char text[3][LCD_1602_SCREEN_CHAR_WIDTH];                               /**< The three text buffers */
+    uint8_t back;                                                           /**< Buffer owned by the writer */
+    uint8_t latest;                                                         /**< Buffer swapped between the sides, with LCD_1602_REGION_FRESH if the writer filled it */
+    uint8_t front;                                                          /**< Buffer owned by the drawer */
+} lcd_1602_region_state_t;
+
+/**
+ * @brief Driver state kept for every display handle.
+ */
+typedef struct {
+    i2c_master_dev_handle_t handle;                                         /**< Device handle the state belongs to, NULL for a free slot */
+    char shadow[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];             /**< What the driver last wrote to the visible DDRAM */
+    uint8_t shadow_rows;                                                    /**< Bitmask of rows whose content is known */
+    uint8_t cursor;                                                         /**< Current DDRAM address or LCD_1602_CURSOR_UNKNOWN */
+    uint8_t display_shift;                                                  /**< Columns the display is shifted left, screen column x shows DDRAM column x + display_shift */
+    LCD_1602_TIMING_MODE timing_mode;                                       /**< How the driver waits for instructions to finish */
+    bool busy_flag_failed;                                                  /**< Reading the busy flag failed, fixed delays are used */
+    bool bus_lost;                                                          /**< A speed change removed the device and could not add it back, handle is only a key */
+    lcd_1602_timing_t timing;                                               /**< Instruction timings used for the display */
+    esp_timer_handle_t delay_timer;                                         /**< One-shot timer for waits longer than LCD_1602_SPIN_MAX_US */
+    SemaphoreHandle_t delay_done;                                           /**< Given by delay_timer to wake the task sleeping on it */
+    SemaphoreHandle_t lock;                                                 /**< Held by every call that uses the display for its whole run and by the render worker for each turn */
+    volatile bool resync_pending;                                           /**< A transfer failed, the LCD may be between nibbles */
+    bool recovering;                                                        /**< Init or re-synchronization in progress */
+    uint8_t cgram[LCD_1602_GLYPH_SLOTS][LCD_1602_GLYPH_ROWS];               /**< Glyph bitmaps last uploaded to the CGRAM slots */
+    uint8_t cgram_slots;                                                    /**< Bitmask of CGRAM slots holding an uploaded glyph */
+    uint32_t cgram_used[LCD_1602_GLYPH_SLOTS];                              /**< When each slot was last used, for LRU eviction */
+    uint32_t cgram_clock;                                                   /**< Counts glyph uses, source of cgram_used */
+    const lcd_1602_glyph_t *glyph_cells[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];    /**< Glyph each cell should show, NULL for text */
+#if LCD_1602_ASYNC
+    bool tx_queue;                                                          /**< The completion callback is registered, transfers are queued */
+    uint8_t tx_buf[I2C_TRANS_QUEUE_DEPTH][LCD_1602_TX_BUF_BYTES];           /**< Copies of the transfers the bus has not finished yet */
+    volatile uint32_t tx_queued;                                            /**< Transfers handed to the bus */
+    volatile uint32_t tx_done;                                              /**< Transfers the bus has finished */
+    volatile uint32_t tx_failed;                                            /**< Transfers the bus has finished with an error */
+    SemaphoreHandle_t tx_wake;                                              /**< Given by the completion callback to wake the task waiting for a transfer */
+    lcd_1602_done_cb_t done_cb;                                             /**< Called when the bus has finished every queued transfer */
+    void *done_arg;                                                         /**< Passed to done_cb */
+#endif
+#if LCD_1602_ENABLE_STATS
+    lcd_1602_stats_t stats;                                                 /**< Performance counters */
+    portMUX_TYPE stats_lock;                                                /**< Guards every update, copy and reset of stats, taken from tasks and the i2c interrupt */
+#endif
+#if LCD_1602_ENABLE_TRACE
+    lcd_1602_trace_entry_t trace[LCD_1602_TRACE_ENTRIES];                   /**< Ring of the latest transfers */
+    uint32_t trace_next;                                                    /**< Number of the next trace entry, claimed atomically by every writer */
+#endif
+
+    struct lcd_1602_render_worker *render_worker;                           /**< Render worker serving the display or NULL if not started */
+    QueueHandle_t render_queue;                                             /**< Single slot queue holding the newest frame */
+    EventGroupHandle_t render_events;                                       /**< Signals finished frames to lcd_1602_flush */
+    SemaphoreHandle_t submit_lock;                                          /**< Serializes numbering and queueing of frames */
+    volatile uint32_t submitted;                                            /**< Sequence number of the newest submitted frame */
+    volatile uint32_t rendered;                                             /**< Sequence number of the newest drawn frame */
+    char render_frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];       /**< Frame being drawn by the render worker */
+    uint8_t render_rows;                                                    /**< Bitmask of rows of render_frame still to draw */
+    uint32_t render_seq;                                                    /**< Sequence number of render_frame */
+    volatile bool render_deferred;                                          /**< The render worker found the display locked, the unlock wakes it */
+
+    uint8_t page;                                                           /**< Page on screen, always 0 without LCD_1602_ENABLE_PAGES */
+    volatile bool marquee_running;                                          /**< The marquee owns the display, never set without LCD_1602_ENABLE_MARQUEE */
+#if LCD_1602_ENABLE_PAGES
+    char page_shadow[LCD_1602_PAGES][LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];   /**< Content of the hidden pages, the page on screen lives in shadow */
+    uint8_t page_rows[LCD_1602_PAGES];                                      /**< Bitmask of rows of each page whose content is known */
+#endif
+#if LCD_1602_ENABLE_REGIONS
+    lcd_1602_region_state_t regions[LCD_1602_MAX_REGIONS];                 /**< Regions registered with lcd_1602_region_add */
+    uint8_t region_count;                                                   /**< Regions used in regions */
+    uint32_t region_dirty;                                                  /**< Bitmask of regions set since they were last drawn, changed atomically */
+    esp_timer_handle_t region_timer;                                        /**< One-shot timer waking the render worker when a rate limited region is due */
+#endif
+#if LCD_1602_ENABLE_SCRUB
+    esp_timer_handle_t scrub_timer;                                         /**< Periodic timer pacing the scrub cycles */
+    volatile bool scrub_due;                                                /**< A scrub cycle is waiting for the render worker */
+    volatile bool scrub_running;                                            /**< The scrub is started */
+    uint8_t scrub_max_cells;                                                /**< Cells read per scrub cycle */
+    uint16_t scrub_pos;                                                     /**< Cell the next scrub cycle starts at, counting through the pages row by row */
+    lcd_1602_scrub_stats_t scrub_stats;                                     /**< Scrub counters */
+#endif
+#if LCD_1602_ENABLE_MARQUEE
+    char marquee_text[LCD_1602_MAX_ROWS][LCD_1602_MARQUEE_MAX_LEN];         /**< Text of each row of the marquee */
+    uint8_t marquee_len[LCD_1602_MAX_ROWS];                                 /**< Characters used in each row of marquee_text */
+    uint32_t marquee_pos;                                                   /**< Position in the looped text shown in the first screen column */
+    esp_timer_handle_t marquee_timer;                                       /**< Periodic timer pacing the marquee steps */
+    volatile bool marquee_due;                                              /**< A step is waiting for the render worker */
+#endif
+} lcd_1602_state_t;
+
+/* Exported functions ----------------------------------------------------------------------------*/
+/**
+ * @brief Finds the driver state for a device handle, claiming a free slot on first use.
+ * 
+ * @param handle Device handle for the i2c bus
+ * 
+ * @return pointer to the state or NULL if all LCD_1602_MAX_DISPLAYS slots are taken.
+ */
+lcd_1602_state_t *lcd_1602_get_state(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Takes the lock of the display, waiting while another task uses it. Every public call
+ * that uses the display holds it for its whole run, so its cursor and shadow bookkeeping never
+ * mixes with the render worker's or another task's. Not recursive, calls built on other
+ * public calls use the internal functions.
+ * 
+ * @param state the state of the display, may be NULL
+ */
+void lcd_1602_lock(lcd_1602_state_t *state);
+
+/**
+ * @brief Gives back the lock taken with lcd_1602_lock and wakes the render worker if it
+ * passed the display over meanwhile.
+ * 
+ * @param state the state of the display, may be NULL
+ */
+void lcd_1602_unlock(lcd_1602_state_t *state);
+
+/**
+ * @brief Waits at least the given time independent of the FreeRTOS tick rate. Short waits are
+ * busy-waited, longer ones sleep on an esp_timer and wake up through a binary semaphore of the
+ * display, which leaves the task notification value alone.
+ * 
+ * @param state the state of the display waiting, may be NULL. The caller holds its lock
+ * @param us microseconds to wait
+ */
+void lcd_1602_delay_us(lcd_1602_state_t *state, uint32_t us);
+
+/**
+ * @brief Lays out a string on a screen sized frame the same way lcd_1602_send_string writes it.
+ * Cells that are not written are left as spaces.
+ * 
+ * @param str the string to lay out
+ * @param[out] frame the resulting screen content
+ * @param[out] lens amount of characters written on each row
+ * 
+ * @return LCD_WRITE_FINISHED if everything fit. LCD_WRITE_INTERRUPTED if string is too long for screen.
+ */
+LCD_WRITE_STATUS lcd_1602_layout_text(const char *str, char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t lens[LCD_1602_MAX_ROWS]);
+
+/**
+ * @brief Brings the screen up to date with a string, see lcd_1602_update. Not counted as a
+ * public call, for the calls built on it.
+ * 
+ * @param state the state of the display
+ * @param str the string to be shown
+ * 
+ * @return the status lcd_1602_update returns.
+ */
+LCD_WRITE_STATUS lcd_1602_update_text(lcd_1602_state_t *state, const char *str);
+
+/**
+ * @brief Clears the display and the shadow, see lcd_1602_clear_screen. Not counted as a
+ * public call, for the calls built on it.
+ * 
+ * @param handle Device handle for the i2c bus
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_clear_display(i2c_master_dev_handle_t handle);
+
+/**
+ * @brief Sends the cells of one row that differ from a shadow, as one burst when possible.
+ * 
+ * @param state the state of the display
+ * @param frame the wanted content
+ * @param row the row to bring up to date
+ * @param shadow what the driver last wrote to the DDRAM columns, updated as cells are sent
+ * @param shadow_rows bitmask of rows of shadow whose content is known, updated
+ * @param offset DDRAM column of the first column of frame
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_draw_row(lcd_1602_state_t *state, const char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t row,
+                          char shadow[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t *shadow_rows, uint8_t offset);
+
+/**
+ * @brief Sends the cells of one row that differ from the shadow, as one burst when possible.
+ * 
+ * @param state the state of the display
+ * @param frame the wanted screen content
+ * @param row the row to bring up to date
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_update_row(lcd_1602_state_t *state, const char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t row);
+
+/**
+ * @brief Reads characters back from the DDRAM, moving the address counter like a write would.
+ * 
+ * @param state the state of the display
+ * @param addr DDRAM address of the first character
+ * @param[out] buf the characters read
+ * @param len characters to read
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_read_ddram(lcd_1602_state_t *state, uint8_t addr, uint8_t *buf, uint8_t len);
+
+/**
+ * @brief Forgets the glyphs of the cells in a row that a text frame is about to overwrite,
+ * so their CGRAM slots can be evicted and they are not repainted later.
+ * 
+ * @param state the state of the display
+ * @param frame the text frame being drawn
+ * @param row the row being drawn
+ */
+void lcd_1602_glyph_release(lcd_1602_state_t *state, const char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t row);
+
+/**
+ * @brief Uploads every cached glyph to its CGRAM slot again, after a fault that may have hit
+ * an upload or garbled the CGRAM.
+ * 
+ * @param state the state of the display
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_glyph_restore(lcd_1602_state_t *state);
+
+/**
+ * @brief Resets the page bookkeeping after the DDRAM was cleared or lost, page 0 is on screen.
+ * Only sets the page without LCD_1602_ENABLE_PAGES.
+ * 
+ * @param state the state of the display
+ * @param cleared true if the whole DDRAM holds spaces, false if its content is unknown
+ */
+void lcd_1602_pages_reset(lcd_1602_state_t *state, bool cleared);
+
+/**
+ * @brief Wakes the render worker of a display to look for work. Safe to call from an
+ * esp_timer callback.
+ * 
+ * @param state the state of a display with a started render worker
+ */
+void lcd_1602_render_wake(lcd_1602_state_t *state);
+
+/**
+ * @brief Takes the next marquee step for the display if the timer asked for one. Run by the
+ * render worker so steps share the bus fairly with everything else it draws. Always false
+ * without LCD_1602_ENABLE_MARQUEE.
+ * 
+ * @param state the state of the display
+ * 
+ * @return true if a step was taken.
+ */
+bool lcd_1602_marquee_step(lcd_1602_state_t *state);
+
+/**
+ * @brief Writes both DDRAM lines completely with what the running marquee holds at its
+ * position, the columns off screen included, and updates the shadow. The display must be
+ * shifted to the position already. Only called while the marquee runs.
+ * 
+ * @param state the state of the display
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_marquee_fill(lcd_1602_state_t *state);
+
+/**
+ * @brief Draws the regions of the display that were set and are due, every changed row as
+ * one burst, and arms the region timer for the rate limited ones still waiting. Always false
+ * without LCD_1602_ENABLE_REGIONS.
+ * 
+ * @param state the state of the display
+ * @param[out] err 0 for success, else for fail
+ * 
+ * @return true if anything was drawn.
+ */
+bool lcd_1602_region_step(lcd_1602_state_t *state, uint8_t *err);
+
+/**
+ * @brief Writes the text last drawn for every region that has been drawn into a frame, so
+ * the frame leaves the regions as they are. Does nothing without LCD_1602_ENABLE_REGIONS.
+ * 
+ * @param state the state of the display
+ * @param[in,out] frame the frame to draw
+ */
+void lcd_1602_region_overlay(const lcd_1602_state_t *state, char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH]);
+
+/**
+ * @brief Runs a scrub cycle for the display if the timer asked for one. Always false without
+ * LCD_1602_ENABLE_SCRUB.
+ * 
+ * @param state the state of the display
+ * 
+ * @return true if a cycle was run.
+ */
+bool lcd_1602_scrub_step(lcd_1602_state_t *state);
+
+/**
+ * @brief Appends a full byte (both nibbles) to a burst.
+ * 
+ * @param burst burst to append to
+ * @param byte command or character to be encoded
+ * @param rs true = char and false = command
+ * 
+ * @return 0 for success, 1 if the burst is full.
+ */
+uint8_t lcd_1602_burst_push(lcd_1602_burst_t *burst, uint8_t byte, bool rs);
+
+/**
+ * @brief Sends everything queued in the burst as one i2c transaction and empties it.
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param burst burst to be sent
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_burst_flush(i2c_master_dev_handle_t handle, lcd_1602_burst_t *burst);
+
+/**
+ * @brief Appends a byte to a burst, sending the burst first if it is full.
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param burst burst to append to
+ * @param byte command or character to be encoded
+ * @param rs true = char and false = command
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_burst_queue(i2c_master_dev_handle_t handle, lcd_1602_burst_t *burst, uint8_t byte, bool rs);
+
+/**
+ * @brief Returns the DDRAM address of a column in a DDRAM line
+ * 
+ * @param x column in the DDRAM line, wraps at LCD_1602_DDRAM_COLS
+ * @param y row on the device
+ */
+uint8_t lcd_1602_ddram_addr(uint8_t x, uint8_t y);
+
+/**
+ * @brief Returns the DDRAM address shown in a cell of the screen, following the display shift
+ * 
+ * @param state the state of the display, NULL for an unshifted display
+ * @param x column on the screen
+ * @param y row on the device
+ */
+uint8_t lcd_1602_cell_addr(const lcd_1602_state_t *state, uint8_t x, uint8_t y);
+
+/**
+ * @brief Returns where the address counter points after writing a character at addr
+ * 
+ * @param addr DDRAM address written to
+ */
+uint8_t lcd_1602_addr_after(uint8_t addr);
+
+/**
+ * @brief Appends a set DDRAM address command for the specified position to a burst
+ * 
+ * @param burst burst to append to
+ * @param x column in the DDRAM line
+ * @param y row on the device
+ * 
+ * @return 0 for success, 1 if the burst is full.
+ */
+uint8_t lcd_1602_burst_goto(lcd_1602_burst_t *burst, uint8_t x, uint8_t y);
+
+/**
+ * @brief Shifts the display the shorter way round to a new shift, all steps in one burst with
+ * the display left on. Leaves the address counter alone.
+ * 
+ * @param state the state of the display
+ * @param shift columns the display is to be shifted left, below LCD_1602_DDRAM_COLS
+ * 
+ * @return 0 for success, else for fail.
+ */
+uint8_t lcd_1602_shift_display(lcd_1602_state_t *state, uint8_t shift);
+
+/**
+ * @brief Re-synchronizes the LCD and replays the shadow if a transfer failed since the last
+ * time. Called at the end of every operation that writes to the LCD.
+ * 
+ * @param state the state of the display, may be NULL
+ * @param err result of the operation so far
+ * 
+ * @return err if nothing was pending, otherwise the result of the re-synchronization.
+ */
+uint8_t lcd_1602_recover(lcd_1602_state_t *state, uint8_t err);
+
+/**
+ * @brief Writes to the expander. Every bus access of the driver goes through here or
+ * lcd_1602_bus_receive so it can be counted. A failed transfer is retried up to
+ * LCD_1602_BUS_RETRIES times after resetting the bus and flags the display for
+ * re-synchronization. The caller holds the bus lock.
+ * With LCD_1602_ASYNC the bytes are copied and queued, the call returns before they are on
+ * the wire. A transfer that fails later flags the display for re-synchronization from the
+ * completion callback.
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param buf bytes to write
+ * @param len amount of bytes
+ * 
+ * @return the result of i2c_master_transmit.
+ */
+esp_err_t lcd_1602_bus_transmit(i2c_master_dev_handle_t handle, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Reads from the expander, see lcd_1602_bus_transmit. With LCD_1602_ASYNC the read is
+ * queued behind the writes still in flight and waited for.
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param[out] buf bytes read
+ * @param len amount of bytes
+ * 
+ * @return the result of i2c_master_receive.
+ */
+esp_err_t lcd_1602_bus_receive(i2c_master_dev_handle_t handle, uint8_t *buf, size_t len);
+
+/**
+ * @brief Waits until the bus has finished every transfer queued for the display. Returns at
+ * once without LCD_1602_ASYNC.
+ * 
+ * @param state the state of the display, may be NULL
+ */
+void lcd_1602_bus_wait(lcd_1602_state_t *state);
+
+#if LCD_1602_ENABLE_STATS
+/**
+ * @brief Counts an i2c transaction, use LCD_1602_STATS_BUS.
+ */
+void lcd_1602_stats_bus(lcd_1602_state_t *state, size_t sent, size_t received, esp_err_t err, int64_t us);
+
+/**
+ * @brief Counts a failed i2c transaction by its error code, use LCD_1602_STATS_ERROR.
+ */
+void lcd_1602_stats_error(lcd_1602_state_t *state, esp_err_t err);
+
+/**
+ * @brief Counts time spent waiting for the LCD, use LCD_1602_STATS_DELAY.
+ */
+void lcd_1602_stats_delay(lcd_1602_state_t *state, int64_t us);
+
+/**
+ * @brief Counts a public call, use LCD_1602_STATS_API.
+ */
+void lcd_1602_stats_api(lcd_1602_state_t *state, LCD_1602_API api, int64_t us);
+
+/**
+ * @brief Adds one to a counter of the display's stats, use LCD_1602_STATS_RESYNC and
+ * LCD_1602_STATS_GLYPH.
+ */
+void lcd_1602_stats_count(lcd_1602_state_t *state, uint32_t *counter);
+#endif
+
+#if LCD_1602_ENABLE_TRACE
+/**
+ * @brief Records a transfer in the trace ring, use LCD_1602_TRACE. Safe to call from any task
+ * and from interrupts, writers claim their entries with one atomic add.
+ */
+void lcd_1602_trace(lcd_1602_state_t *state, uint8_t flags, const uint8_t *buf, size_t len, esp_err_t err, uint32_t time_us);
+#endif
+
 /* Exported macros -------------------------------------------------------------------------------*/
 /** @defgroup internal_macros Internal Macros
  *  @{ 
@@ -134,6 +680,82 @@ extern "C" {
  */
 #define LCD_1602_FUNCTION_SET(dl, r, f) ((LCD_1602_FUNCTION_SET_FLAG | dl | r | f) & LCD_1602_FUNCTION_SET_MASK)
 
+/**
+ * @brief Compile-time PCF8574 encoding, the same bytes lcd_1602_burst_push produces.
+ * 
+ * - LCD_1602_PCF_NIBBLE clocks the upper four bits of nibble in, followed by the settle bytes
+ * - LCD_1602_PCF_BYTE clocks both nibbles of byte in, followed by the settle bytes
+ * 
+ * LCD_1602_BURST_SETTLE_BYTES must be a plain number from 0 to 4 for these.
+ */
+#define LCD_1602_PCF_DATA(nibble, rs)   (((nibble) & 0xF0) | LCD_1602_BACKLIGHT | ((rs) ? LCD_1602_RS : 0))
+#define LCD_1602_PCF_PULSE(nibble, rs)  (LCD_1602_PCF_DATA(nibble, rs) | LCD_1602_ENABLE), LCD_1602_PCF_DATA(nibble, rs)
+#define LCD_1602_PCF_SETTLE_0(low)
+#define LCD_1602_PCF_SETTLE_1(low)      , low
+#define LCD_1602_PCF_SETTLE_2(low)      , low, low
+#define LCD_1602_PCF_SETTLE_3(low)      , low, low, low
+#define LCD_1602_PCF_SETTLE_4(low)      , low, low, low, low
+#define LCD_1602_PCF_SETTLE_N(n, low)   LCD_1602_PCF_SETTLE_##n(low)
+#define LCD_1602_PCF_SETTLE(n, low)     LCD_1602_PCF_SETTLE_N(n, low)
+#define LCD_1602_PCF_NIBBLE(nibble, rs) LCD_1602_PCF_PULSE(nibble, rs) LCD_1602_PCF_SETTLE(LCD_1602_BURST_SETTLE_BYTES, LCD_1602_PCF_DATA(nibble, rs))
+#define LCD_1602_PCF_BYTE(byte, rs)     LCD_1602_PCF_PULSE(byte, rs), LCD_1602_PCF_NIBBLE((byte) << 4, rs)
+#define LCD_1602_PCF_NIBBLE_LEN         (2 + LCD_1602_BURST_SETTLE_BYTES)
+#define LCD_1602_PCF_BYTE_LEN           LCD_1602_BURST_BYTES_PER_WRITE
+
+#if LCD_1602_BURST_SETTLE_BYTES > 4
+#error "The init table supports up to 4 settle bytes"
+#endif
+
+/**
+ * @brief The configuration the driver puts the LCD in, used by init and re-synchronization.
+ */
+#define LCD_1602_DEFAULT_FUNCTION_SET   LCD_1602_FUNCTION_SET(LCD_1602_DATA_LEN_4_BIT, LCD_1602_2_ROWS, LCD_1602_FONT_5X10)
+#define LCD_1602_DEFAULT_DISPLAY_SWITCH LCD_1602_CONFIG_DISPLAY_SWITCH(LCD_1602_DISPLAY_ON, LCD_1602_CURSOR_OFF, LCD_1602_N_BLINK_DISPLAY)
+#define LCD_1602_DEFAULT_INPUT_SET      LCD_1602_CONFIG_INPUT_SET(LCD_1602_INCREMENT_MODE, LCD_1602_CURSOR_N_MOVE)
+
+/**
+ * @brief Macros for the performance counters. They compile to nothing unless
+ * LCD_1602_ENABLE_STATS is set.
+ * - LCD_1602_STATS_START declares a start timestamp
+ * - LCD_1602_STATS_BUS counts an i2c transaction that started at start
+ * - LCD_1602_STATS_ERROR counts a queued transaction that failed in the background
+ * - LCD_1602_STATS_DELAY counts a wait that started at start
+ * - LCD_1602_STATS_API counts a public call that started at start, only in the function the
+ *   application called so calls built on other public calls are counted once
+ * - LCD_1602_STATS_RESYNC counts a re-synchronization
+ * - LCD_1602_STATS_GLYPH counts a glyph upload to the CGRAM
+ */
+#if LCD_1602_ENABLE_STATS
+#define LCD_1602_STATS_START(start)                             int64_t start = esp_timer_get_time()
+#define LCD_1602_STATS_BUS(state, sent, received, err, start)   lcd_1602_stats_bus(state, sent, received, err, esp_timer_get_time() - (start))
+#define LCD_1602_STATS_DELAY(state, start)                      lcd_1602_stats_delay(state, esp_timer_get_time() - (start))
+#define LCD_1602_STATS_API(state, api, start)                   lcd_1602_stats_api(state, api, esp_timer_get_time() - (start))
+#define LCD_1602_STATS_ERROR(state, err)                        lcd_1602_stats_error(state, err)
+#define LCD_1602_STATS_RESYNC(state)                            lcd_1602_stats_count(state, &(state)->stats.resyncs)
+#define LCD_1602_STATS_GLYPH(state)                             lcd_1602_stats_count(state, &(state)->stats.glyph_uploads)
+#else
+#define LCD_1602_STATS_START(start)
+#define LCD_1602_STATS_BUS(state, sent, received, err, start)   ((void)0)
+#define LCD_1602_STATS_DELAY(state, start)                      ((void)0)
+#define LCD_1602_STATS_API(state, api, start)                   ((void)0)
+#define LCD_1602_STATS_ERROR(state, err)                        ((void)0)
+#define LCD_1602_STATS_RESYNC(state)                            ((void)0)
+#define LCD_1602_STATS_GLYPH(state)                             ((void)0)
+#endif
+
+/**
+ * @brief Macros for the trace ring. They compile to nothing unless LCD_1602_ENABLE_TRACE is set.
+ * - LCD_1602_TRACE_START declares a start timestamp
+ * - LCD_1602_TRACE records a transfer that started at start
+ */
+#if LCD_1602_ENABLE_TRACE
+#define LCD_1602_TRACE_START(start)                             uint32_t start = (uint32_t)esp_timer_get_time()
+#define LCD_1602_TRACE(state, flags, buf, len, err, start)      lcd_1602_trace(state, flags, buf, len, err, start)
+#else
+#define LCD_1602_TRACE_START(start)
+#define LCD_1602_TRACE(state, flags, buf, len, err, start)      ((void)0)
+#endif
+
 /** @} internal_macros */
 
 #ifdef __cplusplus
@@ -1,22 +1,249 @@
 #include "lcd_i2c.h"
 
-uint8_t i2c_open(i2c_master_bus_handle_t *bus_handle, i2c_master_dev_handle_t *dev_handle, const uint8_t address) {
+static lcd_i2c_bus_t buses[I2C_MAX_BUSES];
+static portMUX_TYPE buses_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t open_lock;
+
+/**
+ * @brief Returns the mutex that serializes i2c_open, creating it on first use. Two tasks
+ * may both create one, only the first to publish it keeps it.
+ */
+static SemaphoreHandle_t get_open_lock(void) {
+    if(open_lock != NULL) return open_lock;
+
+    SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+    if(lock == NULL) return NULL;
+
+    taskENTER_CRITICAL(&buses_lock);
+    if(open_lock == NULL) {
+        open_lock = lock;
+        lock = NULL;
+    }
+    taskEXIT_CRITICAL(&buses_lock);
+
+    if(lock != NULL) vSemaphoreDelete(lock);
+    return open_lock;
+}
+
+/**
+ * @brief Finds the bus for a port, creating it on first use. Called with open_lock held.
+ * 
+ * @param port i2c port of the bus
+ * @param[out] bus the bus
+ * 
+ * @return ESP_OK, ESP_ERR_NO_MEM if all I2C_MAX_BUSES slots are taken, else the error of the i2c driver.
+ */
+static esp_err_t get_bus(int port, lcd_i2c_bus_t **bus) {
+    lcd_i2c_bus_t *free_slot = NULL;
+
+    for(uint8_t i = 0; i < I2C_MAX_BUSES; i++) {
+        if(buses[i].handle != NULL && buses[i].port == port) {
+            *bus = &buses[i];
+            return ESP_OK;
+        }
+        if(buses[i].handle == NULL && free_slot == NULL) free_slot = &buses[i];
+    }
+
+    if(free_slot == NULL) return ESP_ERR_NO_MEM;
+
     i2c_master_bus_config_t bus_config = {
-        .i2c_port = I2C_MASTER_NUM,
+        .i2c_port = port,
         .sda_io_num = I2C_MASTER_SDA_IO,
         .scl_io_num = I2C_MASTER_SCL_IO,
         .clk_source = I2C_CLK_SRC_DEFAULT,
         .glitch_ignore_cnt = 7,
+        .trans_queue_depth = I2C_TRANS_QUEUE_DEPTH,
         .flags.enable_internal_pullup = true,
     };
-    ESP_ERROR_CHECK(i2c_new_master_bus(&bus_config, bus_handle));
+    i2c_master_bus_handle_t handle = NULL;
+    esp_err_t err = i2c_new_master_bus(&bus_config, &handle);
+    if(err != ESP_OK) return err;
+
+    SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+    if(lock == NULL) {
+        i2c_del_master_bus(handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    free_slot->port = port;
+    free_slot->lock = lock;
+    free_slot->device_count = 0;
+    free_slot->handle = handle;
+
+    *bus = free_slot;
+    return ESP_OK;
+}
+
+uint8_t i2c_open(i2c_master_bus_handle_t *bus_handle, i2c_master_dev_handle_t *dev_handle, const uint8_t address) {
+    SemaphoreHandle_t lock = get_open_lock();
+    if(lock == NULL) return 1;
+
+    // Creating the bus and taking a device slot must not interleave with another open
+    xSemaphoreTake(lock, portMAX_DELAY);
+    lcd_i2c_bus_t *bus = NULL;
+    uint8_t err = get_bus(I2C_MASTER_NUM, &bus) != ESP_OK || bus->device_count >= I2C_MAX_DEVICES_PER_BUS;
 
     i2c_device_config_t dev_config = {
         .dev_addr_length = I2C_DEVICE_ADDRESS_LEN,
         .device_address = address,
         .scl_speed_hz = I2C_MASTER_FREQ_HZ,
     };
-    ESP_ERROR_CHECK(i2c_master_bus_add_device(*bus_handle, &dev_config, dev_handle));
+    if(err == 0) err = i2c_master_bus_add_device(bus->handle, &dev_config, dev_handle) != ESP_OK;
+
+    if(err == 0) {
+        *bus_handle = bus->handle;
+
+        taskENTER_CRITICAL(&buses_lock);
+        bus->addresses[bus->device_count] = address;
+        bus->speeds[bus->device_count] = I2C_MASTER_FREQ_HZ;
+        bus->devices[bus->device_count++] = *dev_handle;
+        taskEXIT_CRITICAL(&buses_lock);
+    }
+    xSemaphoreGive(lock);
+
+    return err;
+}
+
+lcd_i2c_bus_t *i2c_get_bus(i2c_master_dev_handle_t dev_handle) {
+    // Slots of devices lost in i2c_set_speed hold NULL
+    if(dev_handle == NULL) return NULL;
+
+    for(uint8_t i = 0; i < I2C_MAX_BUSES; i++) {
+        for(uint8_t j = 0; j < buses[i].device_count; j++) {
+            if(buses[i].devices[j] == dev_handle) return &buses[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Returns the index of a device on its bus or I2C_MAX_DEVICES_PER_BUS.
+ */
+static uint8_t device_index(const lcd_i2c_bus_t *bus, i2c_master_dev_handle_t dev_handle) {
+    for(uint8_t i = 0; i < bus->device_count; i++) {
+        if(bus->devices[i] == dev_handle) return i;
+    }
+
+    return I2C_MAX_DEVICES_PER_BUS;
+}
 
+uint8_t i2c_set_speed(i2c_master_dev_handle_t *dev_handle, uint32_t scl_hz) {
+    lcd_i2c_bus_t *bus = i2c_get_bus(*dev_handle);
+    if(bus == NULL || scl_hz == 0) return 1;
+
+    // Nobody can queue a transfer between draining the bus and removing the device
+    xSemaphoreTake(bus->lock, portMAX_DELAY);
+    uint8_t i = device_index(bus, *dev_handle);
+    if(i == I2C_MAX_DEVICES_PER_BUS || i2c_wait_done(*dev_handle) != 0) {
+        xSemaphoreGive(bus->lock);
+        return 1;
+    }
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_DEVICE_ADDRESS_LEN,
+        .device_address = bus->addresses[i],
+        .scl_speed_hz = scl_hz,
+    };
+    const uint32_t old_hz = bus->speeds[i];
+    i2c_master_dev_handle_t handle = NULL;
+
+    const bool removed = i2c_master_bus_rm_device(*dev_handle) == ESP_OK;
+    uint8_t err = !removed;
+    if(removed && i2c_master_bus_add_device(bus->handle, &dev_config, &handle) != ESP_OK) {
+        // Try to get the device back at the speed it had
+        dev_config.scl_speed_hz = old_hz;
+        if(i2c_master_bus_add_device(bus->handle, &dev_config, &handle) != ESP_OK) handle = NULL;
+        err = 1;
+    }
+
+    if(removed && handle == NULL) {
+        // Lost at both speeds, nothing may keep pointing at the removed device
+        taskENTER_CRITICAL(&buses_lock);
+        bus->devices[i] = NULL;
+        bus->done[i] = (lcd_i2c_done_t){ .cb = NULL, .arg = NULL };
+        taskEXIT_CRITICAL(&buses_lock);
+        *dev_handle = NULL;
+    }
+    else if(handle != NULL) {
+        taskENTER_CRITICAL(&buses_lock);
+        bus->devices[i] = handle;
+        if(err == 0) bus->speeds[i] = scl_hz;
+        taskEXIT_CRITICAL(&buses_lock);
+        *dev_handle = handle;
+
+        if(bus->done[i].cb != NULL) i2c_on_done(handle, bus->done[i].cb, bus->done[i].arg);
+    }
+    xSemaphoreGive(bus->lock);
+
+    return err;
+}
+
+uint32_t i2c_get_speed(i2c_master_dev_handle_t dev_handle) {
+    lcd_i2c_bus_t *bus = i2c_get_bus(dev_handle);
+    if(bus == NULL) return 0;
+
+    uint8_t i = device_index(bus, dev_handle);
+    return i < I2C_MAX_DEVICES_PER_BUS ? bus->speeds[i] : 0;
+}
+
+#if I2C_TRANS_QUEUE_DEPTH > 0
+/**
+ * @brief Passes the i2c driver's transfer done event on to the callback of the device.
+ */
+static bool on_trans_done(i2c_master_dev_handle_t dev_handle, const i2c_master_event_data_t *evt_data, void *arg) {
+    lcd_i2c_done_t *done = (lcd_i2c_done_t *)arg;
+    esp_err_t err = evt_data->event == I2C_EVENT_DONE ? ESP_OK :
+                    evt_data->event == I2C_EVENT_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+
+    return done->cb(dev_handle, err, done->arg);
+}
+#endif
+
+uint8_t i2c_on_done(i2c_master_dev_handle_t dev_handle, i2c_done_cb_t cb, void *arg) {
+#if I2C_TRANS_QUEUE_DEPTH > 0
+    lcd_i2c_bus_t *bus = i2c_get_bus(dev_handle);
+    if(bus == NULL) return 1;
+
+    uint8_t i = device_index(bus, dev_handle);
+    if(i == I2C_MAX_DEVICES_PER_BUS) return 1;
+
+    bus->done[i] = (lcd_i2c_done_t){ .cb = cb, .arg = arg };
+    const i2c_master_event_callbacks_t cbs = { .on_trans_done = cb != NULL ? on_trans_done : NULL };
+    return i2c_master_register_event_callbacks(dev_handle, &cbs, &bus->done[i]) != ESP_OK;
+#else
+    (void)dev_handle;
+    (void)cb;
+    (void)arg;
+    return 1;
+#endif
+}
+
+uint8_t i2c_wait_done(i2c_master_dev_handle_t dev_handle) {
+#if I2C_TRANS_QUEUE_DEPTH > 0
+    lcd_i2c_bus_t *bus = i2c_get_bus(dev_handle);
+    if(bus == NULL) return 1;
+
+    return i2c_master_bus_wait_all_done(bus->handle, I2C_MASTER_TIMEOUT_MS) != ESP_OK;
+#else
+    (void)dev_handle;
     return 0;
-}
\ No newline at end of file
+#endif
+}
+
+uint8_t i2c_reset(i2c_master_dev_handle_t dev_handle) {
+    lcd_i2c_bus_t *bus = i2c_get_bus(dev_handle);
+    if(bus == NULL) return 1;
+
+    return i2c_master_bus_reset(bus->handle) != ESP_OK;
+}
+
+void i2c_lock(i2c_master_dev_handle_t dev_handle) {
+    lcd_i2c_bus_t *bus = i2c_get_bus(dev_handle);
+    if(bus != NULL && bus->lock != NULL) xSemaphoreTake(bus->lock, portMAX_DELAY);
+}
+
+void i2c_unlock(i2c_master_dev_handle_t dev_handle) {
+    lcd_i2c_bus_t *bus = i2c_get_bus(dev_handle);
+    if(bus != NULL && bus->lock != NULL) xSemaphoreGive(bus->lock);
+}
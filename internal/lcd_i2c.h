@@ -5,6 +5,7 @@
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "driver/i2c_master.h"
 
@@ -14,19 +15,144 @@ extern "C" {
 
 #include "i2c_config.h"
 
+#define I2C_MAX_BUSES               2       /**< Max i2c ports the bus manager keeps track of */
+#define I2C_MAX_DEVICES_PER_BUS     8       /**< Max devices attached to one bus, the PCF8574 has 8 addresses */
+
+#ifndef I2C_TRANS_QUEUE_DEPTH
+#define I2C_TRANS_QUEUE_DEPTH       0       /**< Transfers the bus queues and sends in the background, 0 makes every transfer blocking */
+#endif
+
+/**
+ * @brief Called from the i2c driver's interrupt when a queued transfer is done.
+ * 
+ * @param dev_handle device the transfer was for
+ * @param err ESP_OK, ESP_ERR_TIMEOUT or ESP_FAIL for a NACK
+ * @param arg passed to i2c_on_done
+ * 
+ * @return true if a higher priority task was woken.
+ */
+typedef bool (*i2c_done_cb_t)(i2c_master_dev_handle_t dev_handle, esp_err_t err, void *arg);
+
+/**
+ * @brief Completion callback registered for a device.
+ */
+typedef struct {
+    i2c_done_cb_t cb;                                           /**< Callback or NULL */
+    void *arg;                                                  /**< Passed to cb */
+} lcd_i2c_done_t;
+
+/**
+ * @brief A bus shared by all devices attached to it.
+ */
+typedef struct {
+    i2c_master_bus_handle_t handle;                             /**< Bus handle, NULL for a free slot */
+    int port;                                                   /**< i2c port the bus runs on */
+    SemaphoreHandle_t lock;                                     /**< Serializes access to the bus */
+    i2c_master_dev_handle_t devices[I2C_MAX_DEVICES_PER_BUS];   /**< Devices attached to the bus */
+    uint8_t addresses[I2C_MAX_DEVICES_PER_BUS];                 /**< Address of each device */
+    uint32_t speeds[I2C_MAX_DEVICES_PER_BUS];                   /**< SCL speed of each device in Hz */
+    uint8_t device_count;                                       /**< Devices used in devices */
+    lcd_i2c_done_t done[I2C_MAX_DEVICES_PER_BUS];               /**< Completion callback of each device */
+} lcd_i2c_bus_t;
+
 /**
  * @brief initializes the i2c communications and
  * points the handles to correctly initialized variables
- * on the heap.
+ * on the heap. The bus is only created on the first call,
+ * later calls attach another device to the same bus.
+ * With I2C_TRANS_QUEUE_DEPTH above 0 the bus queues transfers: i2c_master_transmit and
+ * i2c_master_receive return before the transfer is done and the buffers must stay valid
+ * until the callback registered with i2c_on_done has been called.
  * 
  * @param[out] bus_handle handle for initializing the bus
  * @param[out] dev_handle handle for initializing the device on bus
  * @param[in] address device address on bus to communicate with
+ * 
+ * @return 0 for success, 1 if the bus could not be created, is full or the device could not be added.
  */
 uint8_t i2c_open(i2c_master_bus_handle_t *bus_handle, i2c_master_dev_handle_t *dev_handle, const uint8_t address);
 
+/**
+ * @brief Returns the managed bus a device is attached to.
+ * 
+ * @param dev_handle device opened with i2c_open
+ * 
+ * @return the bus or NULL if the device was not opened with i2c_open.
+ */
+lcd_i2c_bus_t *i2c_get_bus(i2c_master_dev_handle_t dev_handle);
+
+/**
+ * @brief Changes the SCL speed of a device. The i2c driver fixes the speed when a device is
+ * added, so the device is removed and added again and gets a new handle. Transfers queued
+ * for the device are waited for first.
+ * 
+ * @param[in,out] dev_handle device opened with i2c_open, replaced by the new handle
+ * @param scl_hz new SCL speed in Hz
+ * 
+ * @return 0 for success, 1 for fail. The old handle stays valid if the device could not be
+ * removed or was added back at its old speed. If it could not be added back at all, *dev_handle
+ * is set to NULL and the device has to be opened again.
+ */
+uint8_t i2c_set_speed(i2c_master_dev_handle_t *dev_handle, uint32_t scl_hz);
+
+/**
+ * @brief Returns the SCL speed of a device.
+ * 
+ * @param dev_handle device opened with i2c_open
+ * 
+ * @return the speed in Hz or 0 if the device was not opened with i2c_open.
+ */
+uint32_t i2c_get_speed(i2c_master_dev_handle_t dev_handle);
+
+/**
+ * @brief Registers the callback called when a transfer queued for the device is done.
+ * 
+ * @param dev_handle device opened with i2c_open
+ * @param cb callback, called from interrupt context
+ * @param arg passed to cb
+ * 
+ * @return 0 for success, 1 if the bus does not queue transfers (I2C_TRANS_QUEUE_DEPTH is 0)
+ * or the device was not opened with i2c_open.
+ */
+uint8_t i2c_on_done(i2c_master_dev_handle_t dev_handle, i2c_done_cb_t cb, void *arg);
+
+/**
+ * @brief Waits until every transfer queued on the bus of the device is done. Returns at once
+ * when the bus does not queue transfers.
+ * 
+ * @param dev_handle device opened with i2c_open
+ * 
+ * @return 0 for success, 1 on timeout or if the device was not opened with i2c_open.
+ */
+uint8_t i2c_wait_done(i2c_master_dev_handle_t dev_handle);
+
+/**
+ * @brief Resets the bus the device is attached to, clocking out a slave that holds SDA low.
+ * The caller holds the bus lock.
+ * 
+ * @param dev_handle device that saw the bus fail
+ * 
+ * @return 0 for success, 1 if the reset failed or the device was not opened with i2c_open.
+ */
+uint8_t i2c_reset(i2c_master_dev_handle_t dev_handle);
+
+/**
+ * @brief Takes the lock of the bus the device is attached to. Devices not opened with
+ * i2c_open are not locked.
+ * 
+ * @param dev_handle device about to use the bus
+ */
+void i2c_lock(i2c_master_dev_handle_t dev_handle);
+
+/**
+ * @brief Gives back the lock taken with i2c_lock.
+ * 
+ * @param dev_handle device done with the bus
+ */
+void i2c_unlock(i2c_master_dev_handle_t dev_handle);
+
 #ifdef __cplusplus
 extern "C" }
 #endif
 
-#endif
\ No newline at end of file
+#endif
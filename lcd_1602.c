@@ -8,160 +8,1115 @@
  -------------------------------------------------------------------------------------------------*/
 
 #include "internal/lcd_1602_internal.h"
+#include <string.h>
 
 /**
- * @brief Sends a nibble (half-byte) using the i2c bus.
+ * @brief Encodes a nibble (half-byte) into the two PCF8574 bytes that clock it into the LCD.
  * 
- * @param handle Device handle for the i2c bus
- * @param nibble half byte to be sent
+ * @param[out] out buffer with room for two bytes
+ * @param nibble half byte to be encoded (upper four bits are used)
  * @param rs true = char and false = command
- * 
- * @return 0 for success and else for fail.
  */
-static uint8_t write_nibble(i2c_master_dev_handle_t handle, uint8_t nibble, bool rs) {
+static void encode_nibble(uint8_t *out, uint8_t nibble, bool rs) {
     uint8_t data = (nibble & 0xF0);
 
     if(rs) data |= LCD_1602_RS;
 
     data |= LCD_1602_BACKLIGHT;
 
-    uint8_t sequence[2];
-    sequence[0] = data | LCD_1602_ENABLE;
-    sequence[1] = data & ~LCD_1602_ENABLE;
-    
-    return i2c_master_transmit(handle, sequence, sizeof(sequence), I2C_MASTER_TIMEOUT_MS / portTICK_PERIOD_MS);
+    out[0] = data | LCD_1602_ENABLE;
+    out[1] = data & ~LCD_1602_ENABLE;
+}
+
+#if LCD_1602_ASYNC
+/**
+ * @brief Called from the i2c interrupt when a transfer queued for the display is done.
+ */
+static bool tx_done_cb(i2c_master_dev_handle_t handle, esp_err_t err, void *arg) {
+    lcd_1602_state_t *state = (lcd_1602_state_t *)arg;
+    BaseType_t woken = pdFALSE;
+
+    if(err != ESP_OK) {
+        // Part of the failed transfer may have reached the LCD, the next call re-synchronizes it
+        state->tx_failed++;
+        state->resync_pending = true;
+        LCD_1602_STATS_ERROR(state, err);
+        LCD_1602_TRACE(state, LCD_1602_TRACE_DONE, NULL, 0, err, (uint32_t)esp_timer_get_time());
+    }
+
+    uint32_t done = state->tx_done + 1;
+    state->tx_done = done;
+    if(done == state->tx_queued && state->done_cb != NULL) state->done_cb(handle, state->done_arg);
+
+    xSemaphoreGiveFromISR(state->tx_wake, &woken);
+
+    return woken == pdTRUE;
+}
+
+/**
+ * @brief Sleeps until the bus has finished more than done transfers of the display. Only the
+ * completion callback gives tx_wake, so notifications of the calling task are left alone. A
+ * give left over from a transfer nobody waited for is dropped first, a give that comes after
+ * that has also counted the transfer, so the check below sees it.
+ */
+static void tx_sleep(lcd_1602_state_t *state, uint32_t done) {
+    xSemaphoreTake(state->tx_wake, 0);
+    if(state->tx_done == done) xSemaphoreTake(state->tx_wake, portMAX_DELAY);
+}
+
+/**
+ * @brief Counts a transfer as in flight and returns its buffer, waiting while every buffer is
+ * still in use by the bus.
+ */
+static uint8_t *tx_reserve(lcd_1602_state_t *state) {
+    uint32_t done;
+
+    while(state->tx_queued - (done = state->tx_done) >= I2C_TRANS_QUEUE_DEPTH) tx_sleep(state, done);
+
+    return state->tx_buf[state->tx_queued++ % I2C_TRANS_QUEUE_DEPTH];
+}
+#endif
+
+esp_err_t lcd_1602_bus_transmit(i2c_master_dev_handle_t handle, const uint8_t *buf, size_t len) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    esp_err_t err = ESP_FAIL;
+    if(state != NULL && state->bus_lost) return ESP_ERR_INVALID_STATE;
+
+#if LCD_1602_ASYNC
+    // The bus sends the transfer after this returns, so it gets a copy that outlives buf
+    const bool queued = state != NULL && state->tx_queue;
+    if(queued) {
+        if(len > LCD_1602_TX_BUF_BYTES) return ESP_ERR_INVALID_SIZE;
+
+        uint8_t *copy = tx_reserve(state);
+        memcpy(copy, buf, len);
+        buf = copy;
+    }
+#endif
+
+    for(uint8_t attempt = 0; attempt <= LCD_1602_BUS_RETRIES; attempt++) {
+        if(attempt > 0) i2c_reset(handle);
+
+        LCD_1602_STATS_START(start);
+        LCD_1602_TRACE_START(trace_start);
+        err = i2c_master_transmit(handle, buf, len, I2C_MASTER_TIMEOUT_MS / portTICK_PERIOD_MS);
+        LCD_1602_STATS_BUS(state, len, 0, err, start);
+        LCD_1602_TRACE(state, 0, buf, len, err, trace_start);
+
+        if(err == ESP_OK) break;
+
+        // Part of the failed transfer may have reached the LCD and left it between nibbles
+        if(state != NULL) state->resync_pending = true;
+    }
+
+#if LCD_1602_ASYNC
+    if(queued && err != ESP_OK) state->tx_queued--;
+    else if(!queued && err == ESP_OK && i2c_wait_done(handle) != 0) err = ESP_ERR_TIMEOUT;
+#endif
+
+    return err;
+}
+
+esp_err_t lcd_1602_bus_receive(i2c_master_dev_handle_t handle, uint8_t *buf, size_t len) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    esp_err_t err = ESP_FAIL;
+    if(state != NULL && state->bus_lost) return ESP_ERR_INVALID_STATE;
+    LCD_1602_TRACE_START(trace_start);
+
+#if LCD_1602_ASYNC
+    // Reads take a place in the queue too, the data is in buf once the transfer is done
+    const bool queued = state != NULL && state->tx_queue;
+    uint32_t failed = queued ? state->tx_failed : 0;
+    if(queued) tx_reserve(state);
+#endif
+
+    for(uint8_t attempt = 0; attempt <= LCD_1602_BUS_RETRIES; attempt++) {
+        if(attempt > 0) i2c_reset(handle);
+
+        LCD_1602_STATS_START(start);
+        err = i2c_master_receive(handle, buf, len, I2C_MASTER_TIMEOUT_MS / portTICK_PERIOD_MS);
+        LCD_1602_STATS_BUS(state, 0, len, err, start);
+
+        if(err == ESP_OK) break;
+        if(state != NULL) state->resync_pending = true;
+    }
+
+#if LCD_1602_ASYNC
+    if(queued && err != ESP_OK) state->tx_queued--;
+    else if(queued) {
+        lcd_1602_bus_wait(state);
+        if(state->tx_failed != failed) err = ESP_FAIL;
+    }
+    else if(err == ESP_OK && i2c_wait_done(handle) != 0) err = ESP_ERR_TIMEOUT;
+#endif
+
+    // Recorded once the data is in buf, which may be after a queued read has waited its turn
+    LCD_1602_TRACE(state, LCD_1602_TRACE_READ, buf, len, err, trace_start);
+
+    return err;
+}
+
+void lcd_1602_bus_wait(lcd_1602_state_t *state) {
+#if LCD_1602_ASYNC
+    if(state == NULL || !state->tx_queue) return;
+
+    uint32_t done;
+    while((done = state->tx_done) != state->tx_queued) tx_sleep(state, done);
+#else
+    (void)state;
+#endif
+}
+
+uint8_t lcd_1602_wait_idle(i2c_master_dev_handle_t handle) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return 1;
+
+    lcd_1602_lock(state);
+    lcd_1602_bus_wait(state);
+    uint8_t err = lcd_1602_recover(state, 0);
+
+    // The re-synchronization is queued as well
+    lcd_1602_bus_wait(state);
+    err = err != 0 || state->resync_pending;
+    lcd_1602_unlock(state);
+
+    return err;
+}
+
+uint8_t lcd_1602_set_done_callback(i2c_master_dev_handle_t handle, lcd_1602_done_cb_t cb, void *arg) {
+#if LCD_1602_ASYNC
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || !state->tx_queue) return 1;
+
+    // Never let the interrupt see the new callback with the old argument
+    state->done_cb = NULL;
+    state->done_arg = arg;
+    state->done_cb = cb;
+
+    return 0;
+#else
+    (void)handle;
+    (void)cb;
+    (void)arg;
+    return 1;
+#endif
+}
+
+uint8_t lcd_1602_burst_push(lcd_1602_burst_t *burst, uint8_t byte, bool rs) {
+    if(burst->len + LCD_1602_BURST_BYTES_PER_WRITE > sizeof(burst->buf)) return 1;
+
+    uint8_t *out = &burst->buf[burst->len];
+    encode_nibble(&out[0], byte & 0xF0, rs);
+    encode_nibble(&out[2], (byte << 4) & 0xF0, rs);
+
+#if LCD_1602_BURST_SETTLE_BYTES > 0
+    for(uint8_t i = 0; i < LCD_1602_BURST_SETTLE_BYTES; i++) {
+        out[4 + i] = out[3];
+    }
+#endif
+
+    burst->len += LCD_1602_BURST_BYTES_PER_WRITE;
+    return 0;
 }
 
 /**
- * @brief sends command with proper delays between broadcasts
+ * @brief Appends a single nibble to a burst, used while the LCD is still in 8-bit mode.
  * 
- * @param handle Device handle for the i2c bus
- * @param cmd Byte for command to be send. Specified commands exists in lcd_1602_internal.h
+ * @param burst burst to append to
+ * @param nibble half byte to be encoded (upper four bits are used)
+ * @param rs true = char and false = command
  * 
- * @return 0 for success, else for fail.
+ * @return 0 for success, 1 if the burst is full.
  */
-static uint8_t send_command(i2c_master_dev_handle_t handle, uint8_t cmd) {
+static uint8_t burst_push_nibble(lcd_1602_burst_t *burst, uint8_t nibble, bool rs) {
+    if(burst->len + 2 > sizeof(burst->buf)) return 1;
+
+    encode_nibble(&burst->buf[burst->len], nibble, rs);
+    burst->len += 2;
+    return 0;
+}
+
+uint8_t lcd_1602_burst_queue(i2c_master_dev_handle_t handle, lcd_1602_burst_t *burst, uint8_t byte, bool rs) {
     uint8_t err = 0;
 
-    uint8_t high = cmd & 0xF0;
-    uint8_t low = (cmd << 4) & 0xF0;
+    if(lcd_1602_burst_push(burst, byte, rs)) {
+        err = lcd_1602_burst_flush(handle, burst);
+        lcd_1602_burst_push(burst, byte, rs);
+    }
+
+    return err;
+}
+
+uint8_t lcd_1602_burst_flush(i2c_master_dev_handle_t handle, lcd_1602_burst_t *burst) {
+    if(burst->len == 0) return 0;
 
-    err = write_nibble(handle, high, false);
-    vTaskDelay(pdMS_TO_TICKS(2));
-    err = write_nibble(handle, low, false);
-    vTaskDelay(pdMS_TO_TICKS(2));
+    i2c_lock(handle);
+    uint8_t err = lcd_1602_bus_transmit(handle, burst->buf, burst->len) != ESP_OK;
+    i2c_unlock(handle);
+    burst->len = 0;
 
     return err;
 }
 
 /**
- * @brief sends a character with proper delays between broadcasts
+ * @brief Datasheet timings with margin for controllers running on a slow oscillator.
+ */
+static const lcd_1602_timing_t default_timing = LCD_1602_TIMING_DEFAULT;
+
+/**
+ * @brief Timer callback that wakes the task waiting in lcd_1602_delay_us.
+ */
+static void delay_timer_cb(void *arg) {
+    lcd_1602_state_t *state = (lcd_1602_state_t *)arg;
+    xSemaphoreGive(state->delay_done);
+}
+
+/**
+ * @brief Does the actual waiting for lcd_1602_delay_us.
+ */
+static void delay_us(lcd_1602_state_t *state, uint32_t us) {
+    if(us <= LCD_1602_SPIN_MAX_US) {
+        esp_rom_delay_us(us);
+        return;
+    }
+
+    if(state != NULL && state->delay_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = delay_timer_cb,
+            .arg = state,
+            .name = "lcd_1602_delay",
+        };
+        if(state->delay_done == NULL) state->delay_done = xSemaphoreCreateBinary();
+        if(state->delay_done == NULL || esp_timer_create(&args, &state->delay_timer) != ESP_OK) state->delay_timer = NULL;
+    }
+
+    if(state == NULL || state->delay_timer == NULL) {
+        // No timer, round up to whole ticks so the wait is never shorter than asked for
+        const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+        vTaskDelay((us + tick_us - 1) / tick_us);
+        return;
+    }
+
+    /*
+    Sleep on the timer and spin away what is left. Only the timer gives delay_done and the
+    display lock keeps other tasks from waiting on it, so notifications the task gets for other
+    reasons do not end the wait. Should the timer never fire, it is stopped and a late give
+    taken back before spinning, so the next wait does not start out woken.
+    */
+    int64_t deadline = esp_timer_get_time() + us;
+    int64_t remaining = us;
+    const TickType_t tick_us = portTICK_PERIOD_MS * 1000;
+
+    while(remaining > LCD_1602_SPIN_MAX_US) {
+        if(esp_timer_start_once(state->delay_timer, remaining) != ESP_OK) break;
+        if(xSemaphoreTake(state->delay_done, (remaining + tick_us - 1) / tick_us + 1) != pdTRUE) {
+            esp_timer_stop(state->delay_timer);
+            xSemaphoreTake(state->delay_done, 0);
+            break;
+        }
+        remaining = deadline - esp_timer_get_time();
+    }
+
+    remaining = deadline - esp_timer_get_time();
+    if(remaining > 0) esp_rom_delay_us((uint32_t)remaining);
+}
+
+void lcd_1602_delay_us(lcd_1602_state_t *state, uint32_t us) {
+    if(us == 0) return;
+
+    // Instruction times count from when the last transfer has left the bus
+    lcd_1602_bus_wait(state);
+
+    LCD_1602_STATS_START(start);
+    delay_us(state, us);
+    LCD_1602_STATS_DELAY(state, start);
+}
+
+/**
+ * @brief Returns the timing profile used for a display.
+ */
+static const lcd_1602_timing_t *timing_of(const lcd_1602_state_t *state) {
+    return state != NULL ? &state->timing : &default_timing;
+}
+
+/**
+ * @brief Reads the busy flag of the LCD through the PCF8574 with R/W high.
+ * Both nibbles are clocked so the LCD stays in sync, only the first is read.
  * 
  * @param handle Device handle for the i2c bus
- * @param c character to be sent
+ * @param[out] busy true if the LCD is still executing an instruction
  * 
  * @return 0 for success, else for fail.
  */
- uint8_t lcd_1602_send_char(i2c_master_dev_handle_t handle, char c) {
-    uint8_t err = 0;
+static uint8_t read_busy_flag(i2c_master_dev_handle_t handle, bool *busy) {
+    // Data pins are driven high so the PCF8574 can read them back
+    const uint8_t base = 0xF0 | LCD_1602_BACKLIGHT | LCD_1602_RW;
+    uint8_t enable[2] = { base, base | LCD_1602_ENABLE };
+    uint8_t finish[3] = { base, base | LCD_1602_ENABLE, base };
+    uint8_t port = 0;
 
-    uint8_t high = c & 0xF0;
-    uint8_t low = (c << 4) & 0xF0;
+    i2c_lock(handle);
+    uint8_t err = lcd_1602_bus_transmit(handle, enable, sizeof(enable)) != ESP_OK;
+    if(err == 0) err = lcd_1602_bus_receive(handle, &port, 1) != ESP_OK;
+    uint8_t finish_err = lcd_1602_bus_transmit(handle, finish, sizeof(finish)) != ESP_OK;
+    i2c_unlock(handle);
 
-    err = write_nibble(handle, high, true);
-    vTaskDelay(pdMS_TO_TICKS(2));
-    err = write_nibble(handle, low, true);
-    vTaskDelay(pdMS_TO_TICKS(2));
+    *busy = (port & LCD_1602_BUSY_FLAG) != 0;
+    return err ? err : finish_err;
+}
 
-    return err;
+/**
+ * @brief Reads a full byte from the LCD through the PCF8574 with R/W high.
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param rs false for the instruction register (busy flag in bit 7 and the address counter in
+ * bits 0-6), true for the data at the address counter, which then moves on
+ * @param[out] value the byte read
+ * 
+ * @return 0 for success, else for fail.
+ */
+static uint8_t read_byte(i2c_master_dev_handle_t handle, bool rs, uint8_t *value) {
+    const uint8_t base = 0xF0 | LCD_1602_BACKLIGHT | LCD_1602_RW | (rs ? LCD_1602_RS : 0);
+    uint8_t enable[2] = { base, base | LCD_1602_ENABLE };
+    uint8_t finish[1] = { base };
+    uint8_t high = 0;
+    uint8_t low = 0;
+
+    i2c_lock(handle);
+    uint8_t err = lcd_1602_bus_transmit(handle, enable, sizeof(enable)) != ESP_OK;
+    if(err == 0) err = lcd_1602_bus_receive(handle, &high, 1) != ESP_OK;
+    if(err == 0) err = lcd_1602_bus_transmit(handle, enable, sizeof(enable)) != ESP_OK;
+    if(err == 0) err = lcd_1602_bus_receive(handle, &low, 1) != ESP_OK;
+    uint8_t finish_err = lcd_1602_bus_transmit(handle, finish, sizeof(finish)) != ESP_OK;
+    i2c_unlock(handle);
+
+    *value = (high & 0xF0) | (low >> 4);
+    return err ? err : finish_err;
 }
 
 /**
- * @brief Clear screen and returns DDRAM address to 0 (first row, first character)
+ * @brief Returns how long one busy flag read keeps the bus at the speed of the display.
+ */
+static uint32_t busy_read_us(const lcd_1602_state_t *state) {
+    uint32_t scl_hz = i2c_get_speed(state->handle);
+    if(scl_hz == 0) scl_hz = I2C_MASTER_FREQ_HZ;
+
+    // Every byte on the bus takes 9 clocks with the ACK
+    return (uint32_t)((uint64_t)LCD_1602_BUSY_READ_BYTES * 9 * 1000000 / scl_hz);
+}
+
+/**
+ * @brief Waits until the LCD is ready for the next instruction. Polls the busy flag when the
+ * display uses LCD_1602_TIMING_BUSY_FLAG and the wait is long enough for polling to end it
+ * early, and falls back to the fixed delay if the read path is unavailable.
  * 
- * @param handle Device handle for the i2c buss
+ * @param handle Device handle for the i2c bus
+ * @param fixed_us worst case delay to use when the busy flag can not be read
+ */
+static void wait_ready(i2c_master_dev_handle_t handle, uint32_t fixed_us) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+
+    // Polling only pays off when several reads fit into the fixed delay, a read that finds the
+    // LCD busy costs as much bus time as it could save
+    if(state != NULL && state->timing_mode == LCD_1602_TIMING_BUSY_FLAG && !state->busy_flag_failed
+       && fixed_us >= LCD_1602_BUSY_POLL_MIN_READS * busy_read_us(state)) {
+        bool busy = true;
+
+        for(uint16_t i = 0; i < LCD_1602_BUSY_POLL_MAX; i++) {
+            if(read_busy_flag(handle, &busy) != 0) {
+                // No read path (e.g. R/W tied to ground), stick to the fixed delays from now on
+                state->busy_flag_failed = true;
+                break;
+            }
+            if(!busy) return;
+        }
+    }
+
+    lcd_1602_delay_us(state, fixed_us);
+}
+
+/**
+ * @brief sends a command as a single i2c transaction
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param cmd Byte for command to be send. Specified commands exists in lcd_1602_internal.h
+ * @param exec_us worst case execution time of the command, waited for once after sending
  * 
  * @return 0 for success, else for fail.
  */
- uint8_t lcd_1602_clear_screen(i2c_master_dev_handle_t handle) {
-    uint8_t err = send_command(handle, LCD_1602_CLEAR_SCREEN);
-    vTaskDelay(pdMS_TO_TICKS(10));
+static uint8_t send_command(i2c_master_dev_handle_t handle, uint8_t cmd, uint32_t exec_us) {
+    lcd_1602_burst_t burst = { .len = 0 };
+
+    lcd_1602_burst_push(&burst, cmd, false);
+    uint8_t err = lcd_1602_burst_flush(handle, &burst);
+    wait_ready(handle, exec_us);
+
+    return err;
+}
+
+uint8_t lcd_1602_read_ddram(lcd_1602_state_t *state, uint8_t addr, uint8_t *buf, uint8_t len) {
+    lcd_1602_burst_t burst = { .len = 0 };
+
+    lcd_1602_burst_push(&burst, LCD_1602_SET_DDRAM_ADDR | addr, false);
+    uint8_t err = lcd_1602_burst_flush(state->handle, &burst);
+    lcd_1602_delay_us(state, state->timing.instr_us);
+
+    for(uint8_t i = 0; i < len && err == 0; i++) {
+        err = read_byte(state->handle, true, &buf[i]);
+        addr = lcd_1602_addr_after(addr);
+    }
+
+    state->cursor = err == 0 ? addr : LCD_1602_CURSOR_UNKNOWN;
     return err;
 }
 
 /**
- * @brief Sets the DDRAM address to specified position on the screen
+ * @brief Finds the driver state for a device handle, claiming a free slot on first use.
  * 
  * @param handle Device handle for the i2c bus
- * @param x column on the device
- * @param y row on the device
  * 
- * @return 0 for success, else for fail.
+ * @return pointer to the state or NULL if all LCD_1602_MAX_DISPLAYS slots are taken.
  */
-static uint8_t lcd_goto(i2c_master_dev_handle_t handle, uint8_t x, uint8_t y) {
+lcd_1602_state_t *lcd_1602_get_state(i2c_master_dev_handle_t handle) {
+    static lcd_1602_state_t states[LCD_1602_MAX_DISPLAYS];
+    static portMUX_TYPE states_lock = portMUX_INITIALIZER_UNLOCKED;
+    if(handle == NULL) return NULL;
+
+    for(uint8_t i = 0; i < LCD_1602_MAX_DISPLAYS; i++) {
+        if(states[i].handle == handle) return &states[i];
+    }
+
+    /*
+    First use. The objects of the state are created up front and the slot is claimed in one
+    step, with the handle set last, so two tasks using a new display at the same time neither
+    take two slots nor see a state whose lock does not exist yet.
+    */
+    SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+#if LCD_1602_ASYNC
+    SemaphoreHandle_t tx_wake = xSemaphoreCreateBinary();
+#endif
+    lcd_1602_state_t *state = NULL;
+    bool claimed = false;
+
+    taskENTER_CRITICAL(&states_lock);
+    for(uint8_t i = 0; i < LCD_1602_MAX_DISPLAYS && state == NULL; i++) {
+        if(states[i].handle == handle) state = &states[i];
+    }
+    for(uint8_t i = 0; i < LCD_1602_MAX_DISPLAYS && state == NULL; i++) {
+        if(states[i].handle != NULL) continue;
+
+        state = &states[i];
+        state->shadow_rows = 0;
+        state->cursor = LCD_1602_CURSOR_UNKNOWN;
+        state->timing = default_timing;
+        state->lock = lock;
+#if LCD_1602_ASYNC
+        state->tx_wake = tx_wake;
+#endif
+#if LCD_1602_ENABLE_STATS
+        portMUX_INITIALIZE(&state->stats_lock);
+#endif
+        state->handle = handle;
+        claimed = true;
+    }
+    taskEXIT_CRITICAL(&states_lock);
+
+    if(!claimed) {
+        if(lock != NULL) vSemaphoreDelete(lock);
+#if LCD_1602_ASYNC
+        if(tx_wake != NULL) vSemaphoreDelete(tx_wake);
+#endif
+        return state;
+    }
+
+#if LCD_1602_ASYNC
+    state->tx_queue = tx_wake != NULL && i2c_on_done(handle, tx_done_cb, state) == 0;
+#endif
+    return state;
+}
+
+uint8_t lcd_1602_set_timing_mode(i2c_master_dev_handle_t handle, LCD_1602_TIMING_MODE mode) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return 1;
+
+    lcd_1602_lock(state);
+    state->timing_mode = mode;
+    state->busy_flag_failed = false;
+    lcd_1602_unlock(state);
+
+    return 0;
+}
+
+uint8_t lcd_1602_set_timing(i2c_master_dev_handle_t handle, const lcd_1602_timing_t *timing) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || timing == NULL) return 1;
+
+    lcd_1602_lock(state);
+    state->timing = *timing;
+    lcd_1602_unlock(state);
+
+    return 0;
+}
+
+uint8_t lcd_1602_ddram_addr(uint8_t x, uint8_t y) {
     static const uint8_t row_offsets[] = { 0x00, 0x40 };
     if (y > 1) y = 1;
-    uint8_t err = send_command(handle, 0x80 | (row_offsets[y] + x)); 
-    
-    vTaskDelay(pdMS_TO_TICKS(10));
+    return row_offsets[y] + (x % LCD_1602_DDRAM_COLS);
+}
+
+uint8_t lcd_1602_cell_addr(const lcd_1602_state_t *state, uint8_t x, uint8_t y) {
+    uint8_t shift = state != NULL ? state->display_shift : 0;
+    return lcd_1602_ddram_addr(x + shift, y);
+}
+
+uint8_t lcd_1602_addr_after(uint8_t addr) {
+    // In 2-line mode the address counter runs from the end of one line to the start of the other
+    if(addr == LCD_1602_DDRAM_COLS - 1) return 0x40;
+    if(addr == 0x40 + LCD_1602_DDRAM_COLS - 1) return 0x00;
+    return addr + 1;
+}
+
+uint8_t lcd_1602_burst_goto(lcd_1602_burst_t *burst, uint8_t x, uint8_t y) {
+    return lcd_1602_burst_push(burst, LCD_1602_SET_DDRAM_ADDR | lcd_1602_ddram_addr(x, y), false);
+}
+
+/**
+ * @brief sends a character as a single i2c transaction
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param c character to be sent
+ * 
+ * @return 0 for success, else for fail.
+ */
+ uint8_t lcd_1602_send_char(i2c_master_dev_handle_t handle, char c) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    lcd_1602_burst_t burst = { .len = 0 };
+
+    lcd_1602_lock(state);
+    if(state != NULL && state->marquee_running) {
+        lcd_1602_unlock(state);
+        return 1;
+    }
+
+    lcd_1602_burst_push(&burst, (uint8_t)c, true);
+    uint8_t err = lcd_1602_burst_flush(handle, &burst);
+
+    // Keep the shadow in sync if we know where the character landed
+    if(state != NULL && state->cursor != LCD_1602_CURSOR_UNKNOWN) {
+        uint8_t row = (state->cursor & 0x40) ? 1 : 0;
+        uint8_t col = ((state->cursor & 0x3F) + LCD_1602_DDRAM_COLS - state->display_shift) % LCD_1602_DDRAM_COLS;
+        if(col < LCD_1602_SCREEN_CHAR_WIDTH && row < LCD_1602_MAX_ROWS) {
+            state->shadow[row][col] = c;
+            state->glyph_cells[row][col] = NULL;
+        }
+        state->cursor = lcd_1602_addr_after(state->cursor);
+    }
+
+    err = lcd_1602_recover(state, err);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_SEND_CHAR, start);
     return err;
 }
 
-LCD_WRITE_STATUS lcd_1602_send_string(i2c_master_dev_handle_t handle, char *str) {
-    lcd_1602_clear_screen(handle);
+uint8_t lcd_1602_clear_display(i2c_master_dev_handle_t handle) {
+    uint8_t err = send_command(handle, LCD_1602_CLEAR_SCREEN, timing_of(lcd_1602_get_state(handle))->clear_us);
+
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state != NULL) {
+        memset(state->shadow, ' ', sizeof(state->shadow));
+        memset(state->glyph_cells, 0, sizeof(state->glyph_cells));
+        state->shadow_rows = LCD_1602_ALL_ROWS;
+        state->cursor = 0;
+        state->display_shift = 0;
+        lcd_1602_pages_reset(state, true);
+    }
+
+    return lcd_1602_recover(state, err);
+}
+
+/**
+ * @brief Clear screen and returns DDRAM address to 0 (first row, first character)
+ * 
+ * @param handle Device handle for the i2c buss
+ * 
+ * @return 0 for success, else for fail.
+ */
+ uint8_t lcd_1602_clear_screen(i2c_master_dev_handle_t handle) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+
+    lcd_1602_lock(state);
+    uint8_t err = (state != NULL && state->marquee_running) ? 1 : lcd_1602_clear_display(handle);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_CLEAR_SCREEN, start);
+    return err;
+}
+
+LCD_WRITE_STATUS lcd_1602_layout_text(const char *str, char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t lens[LCD_1602_MAX_ROWS]) {
+    memset(frame, ' ', LCD_1602_MAX_ROWS * LCD_1602_SCREEN_CHAR_WIDTH);
+    memset(lens, 0, LCD_1602_MAX_ROWS);
 
-    uint8_t char_len = 0;
     uint8_t row = 0;
 
     while(*str != '\0') {
-        if(*str == '\n' || char_len >= 16) {
-            if(row < LCD_1602_MAX_ROWS) {
-                lcd_goto(handle, 0,1);
+        if(*str == '\n' || lens[row] >= LCD_1602_SCREEN_CHAR_WIDTH) {
+            if(row + 1 < LCD_1602_MAX_ROWS) {
                 row++;
-                char_len = 0;
                 
                 if(*str == '\n') {
                     str++;
                     continue;
                 }  
             }
+            else if(*str == '\n' && str[1] == '\0') {
+                break;
+            }
             else return LCD_WRITE_INTERRUPTED;
         }
 
-        if(*str == '\0') {
-            return LCD_WRITE_FINISHED;
-        }
-
-        lcd_1602_send_char(handle, *str);
-        char_len++;
+        frame[row][lens[row]++] = *str;
         str++;
     }
 
     return LCD_WRITE_FINISHED;
 }
 
-uint8_t lcd_1602_init(i2c_master_dev_handle_t handle) {
+LCD_WRITE_STATUS lcd_1602_send_string(i2c_master_dev_handle_t handle, char *str) {
+    LCD_1602_STATS_START(start);
+    char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];
+    uint8_t lens[LCD_1602_MAX_ROWS];
+
+    LCD_WRITE_STATUS status = lcd_1602_layout_text(str, frame, lens);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+
+    lcd_1602_lock(state);
+    if(state != NULL && state->marquee_running) {
+        lcd_1602_unlock(state);
+        return LCD_WRITE_INTERRUPTED;
+    }
+
+    uint8_t err = lcd_1602_clear_display(handle);
+
+    // One transaction per row, every row after the first starts with its own address
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t cursor = 0;
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        if(lens[row] == 0) continue;
+        if(row > 0) lcd_1602_burst_goto(&burst, 0, row);
+
+        for(uint8_t col = 0; col < lens[row]; col++) {
+            lcd_1602_burst_push(&burst, (uint8_t)frame[row][col], true);
+        }
+        err |= lcd_1602_burst_flush(handle, &burst);
+        cursor = lcd_1602_ddram_addr(lens[row], row);
+    }
+
+    if(state != NULL) {
+        memcpy(state->shadow, frame, sizeof(state->shadow));
+        state->shadow_rows = LCD_1602_ALL_ROWS;
+        state->cursor = cursor;
+    }
+
+    if(lcd_1602_recover(state, err) != 0) status = LCD_WRITE_ERROR;
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_SEND_STRING, start);
+    return status;
+}
+
+uint8_t lcd_1602_draw_row(lcd_1602_state_t *state, const char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t row,
+                          char shadow[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t *shadow_rows, uint8_t offset) {
+    i2c_master_dev_handle_t handle = state->handle;
+    const bool known = (*shadow_rows & (1 << row)) != 0;
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t col = 0;
+    uint8_t err = 0;
+
+    while(col < LCD_1602_SCREEN_CHAR_WIDTH) {
+        if(known && frame[row][col] == shadow[row][col]) {
+            col++;
+            continue;
+        }
+
+        // Grow the span over unchanged gaps that are cheaper to rewrite than to jump over
+        uint8_t end = col + 1;
+        uint8_t gap = 0;
+        for(uint8_t i = end; i < LCD_1602_SCREEN_CHAR_WIDTH; i++) {
+            if(known && frame[row][i] == shadow[row][i]) {
+                if(++gap > LCD_1602_SPAN_MERGE_GAP) break;
+            }
+            else {
+                gap = 0;
+                end = i + 1;
+            }
+        }
+
+        for(; col < end; col++) {
+            uint8_t addr = lcd_1602_ddram_addr(col + offset, row);
+
+            // Jump at the start of the span and where the row wraps around the DDRAM line
+            if(state->cursor != addr) {
+                err |= lcd_1602_burst_queue(handle, &burst, LCD_1602_SET_DDRAM_ADDR | addr, false);
+            }
+            err |= lcd_1602_burst_queue(handle, &burst, (uint8_t)frame[row][col], true);
+
+            shadow[row][col] = frame[row][col];
+            state->cursor = lcd_1602_addr_after(addr);
+        }
+    }
+
+    err |= lcd_1602_burst_flush(handle, &burst);
+    *shadow_rows |= (1 << row);
+
+    return err;
+}
+
+uint8_t lcd_1602_update_row(lcd_1602_state_t *state, const char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t row) {
+    // A re-synchronization replays the shadow, which includes the glyph cells
+    if(!state->recovering) lcd_1602_glyph_release(state, frame, row);
+
+    return lcd_1602_draw_row(state, frame, row, state->shadow, &state->shadow_rows, state->display_shift);
+}
+
+LCD_WRITE_STATUS lcd_1602_update_text(lcd_1602_state_t *state, const char *str) {
+    char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];
+    uint8_t lens[LCD_1602_MAX_ROWS];
+
+    LCD_WRITE_STATUS status = lcd_1602_layout_text(str, frame, lens);
+    uint8_t err = 0;
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        err |= lcd_1602_update_row(state, frame, row);
+    }
+
+    if(lcd_1602_recover(state, err) != 0) status = LCD_WRITE_ERROR;
+
+    return status;
+}
+
+LCD_WRITE_STATUS lcd_1602_update(i2c_master_dev_handle_t handle, const char *str) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return LCD_WRITE_NOT_FINISHED;
+
+    // The next marquee step would draw over the frame in the shadow but not on the LCD
+    lcd_1602_lock(state);
+    LCD_WRITE_STATUS status = state->marquee_running ? LCD_WRITE_INTERRUPTED : lcd_1602_update_text(state, str);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_UPDATE, start);
+    return status;
+}
+
+/**
+ * @brief The init sequence from the datasheet. The first three steps bring the LCD into 4-bit
+ * mode from any state, the rest configures it.
+ */
+static const lcd_1602_init_step_t init_steps[] = {
+    { { LCD_1602_PCF_NIBBLE(0x30, false) }, LCD_1602_PCF_NIBBLE_LEN, LCD_1602_INIT_WAIT_RESET },
+    { { LCD_1602_PCF_NIBBLE(0x30, false) }, LCD_1602_PCF_NIBBLE_LEN, LCD_1602_INIT_WAIT_RESET_SHORT },
+    { { LCD_1602_PCF_NIBBLE(0x30, false), LCD_1602_PCF_NIBBLE(0x20, false) }, 2 * LCD_1602_PCF_NIBBLE_LEN, LCD_1602_INIT_WAIT_INSTR },
+    { {
+        LCD_1602_PCF_BYTE(LCD_1602_DEFAULT_FUNCTION_SET, false),
+        LCD_1602_PCF_BYTE(LCD_1602_DEFAULT_DISPLAY_SWITCH, false),
+        LCD_1602_PCF_BYTE(LCD_1602_DEFAULT_INPUT_SET, false)
+    }, 3 * LCD_1602_PCF_BYTE_LEN, LCD_1602_INIT_WAIT_INSTR },
+    { { LCD_1602_PCF_BYTE(LCD_1602_CLEAR_SCREEN, false) }, LCD_1602_PCF_BYTE_LEN, LCD_1602_INIT_WAIT_CLEAR },
+};
+
+#define INIT_STEP_CONFIG    3   /**< First step an attach to a running 4-bit controller needs */
+#define INIT_STEP_COUNT     (sizeof(init_steps) / sizeof(init_steps[0]))
+
+/**
+ * @brief Sends steps of the init table, chaining every step that only needs a regular
+ * instruction wait into the burst of the next one.
+ * 
+ * @param handle Device handle for the i2c bus
+ * @param first first step to send
+ * @param last one past the last step to send
+ * 
+ * @return 0 for success, else for fail.
+ */
+static uint8_t run_init_steps(i2c_master_dev_handle_t handle, uint8_t first, uint8_t last) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    const lcd_1602_timing_t *timing = timing_of(state);
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = 0;
+
+    for(uint8_t i = first; i < last; i++) {
+        const lcd_1602_init_step_t *step = &init_steps[i];
+
+        memcpy(&burst.buf[burst.len], step->bytes, step->len);
+        burst.len += step->len;
+        if(step->wait == LCD_1602_INIT_WAIT_INSTR && i + 1 < last) continue;
+
+        err |= lcd_1602_burst_flush(handle, &burst);
+
+        // The busy flag can not be read before the LCD is in 4-bit mode
+        switch(step->wait) {
+            case LCD_1602_INIT_WAIT_RESET:          lcd_1602_delay_us(state, timing->reset_us); break;
+            case LCD_1602_INIT_WAIT_RESET_SHORT:    lcd_1602_delay_us(state, timing->reset_short_us); break;
+            case LCD_1602_INIT_WAIT_INSTR:          lcd_1602_delay_us(state, timing->instr_us); break;
+            case LCD_1602_INIT_WAIT_CLEAR:          wait_ready(handle, timing->clear_us); break;
+        }
+    }
+
+    return err;
+}
+
+/**
+ * @brief Forgets everything the driver knew about the content of the LCD.
+ */
+static void forget_screen(lcd_1602_state_t *state) {
+    state->shadow_rows = 0;
+    state->cursor = LCD_1602_CURSOR_UNKNOWN;
+    state->display_shift = 0;
+    lcd_1602_pages_reset(state, false);
+    state->cgram_slots = 0;
+    memset(state->glyph_cells, 0, sizeof(state->glyph_cells));
+}
+
+/**
+ * @brief Runs the full init sequence, see lcd_1602_init.
+ * 
+ * @param handle Device handle for the i2c bus
+ * 
+ * @return 0 for success, else for fail.
+ */
+static uint8_t init(i2c_master_dev_handle_t handle) {
 /*
 This function sets up the standard mode of the LCD and follows
 a specific start up sequence described by the manufacturer.
 */
-    // Manufacturer specific order
-    vTaskDelay(pdMS_TO_TICKS(15));
-    write_nibble(handle, (0x03 << 4), 0);
-    vTaskDelay(pdMS_TO_TICKS(5));
-    write_nibble(handle, (0x03 << 4), 0);
-    vTaskDelay(pdMS_TO_TICKS(2));
-    write_nibble(handle, (0x03 << 4), 0);
-    vTaskDelay(pdMS_TO_TICKS(2));
-    write_nibble(handle, (0x02 << 4), 0);
-    // End of manufacturer specific order
-
-    send_command(handle, LCD_1602_FUNCTION_SET(LCD_1602_DATA_LEN_4_BIT, LCD_1602_2_ROWS, LCD_1602_FONT_5X10));
-    send_command(handle, LCD_1602_CONFIG_DISPLAY_SWITCH(LCD_1602_DISPLAY_ON, LCD_1602_CURSOR_OFF, LCD_1602_N_BLINK_DISPLAY));
-    lcd_1602_clear_screen(handle);
-    send_command(handle, LCD_1602_CONFIG_INPUT_SET(LCD_1602_INCREMENT_MODE, LCD_1602_CURSOR_N_MOVE));
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
 
-    return 0;
+    if(state != NULL) {
+        forget_screen(state);
+        state->recovering = true;
+    }
+
+    lcd_1602_delay_us(state, timing_of(state)->power_on_us);
+    uint8_t err = run_init_steps(handle, 0, INIT_STEP_COUNT);
+
+    // A full init leaves nothing to re-synchronize
+    if(state != NULL) {
+        memset(state->shadow, ' ', sizeof(state->shadow));
+        state->shadow_rows = LCD_1602_ALL_ROWS;
+        state->cursor = 0;
+        lcd_1602_pages_reset(state, true);
+        state->recovering = false;
+        state->resync_pending = err != 0;
+    }
+
+    return err;
+}
+
+uint8_t lcd_1602_init(i2c_master_dev_handle_t handle) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+
+    lcd_1602_lock(state);
+    uint8_t err = init(handle);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_INIT, start);
+    return err;
+}
+
+uint8_t lcd_1602_attach(i2c_master_dev_handle_t handle) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t ir = 0;
+
+    lcd_1602_lock(state);
+
+    // Only a controller running in 4-bit mode and in nibble sync reads back the address
+    lcd_1602_burst_push(&burst, LCD_1602_SET_DDRAM_ADDR | LCD_1602_ATTACH_PROBE_ADDR, false);
+    uint8_t err = lcd_1602_burst_flush(handle, &burst);
+    lcd_1602_delay_us(state, timing_of(state)->instr_us);
+    if(err == 0) err = read_byte(handle, false, &ir);
+
+    if(err != 0 || (ir & 0x7F) != LCD_1602_ATTACH_PROBE_ADDR) {
+        err = init(handle);
+    }
+    else {
+        if(state != NULL) {
+            forget_screen(state);
+            state->recovering = true;
+        }
+
+        // Already in 4-bit mode, apply the configuration and keep what is on screen
+        err = run_init_steps(handle, INIT_STEP_CONFIG, INIT_STEP_COUNT - 1);
+
+        // The display may have been left shifted, return home puts it back where the driver expects it
+        lcd_1602_burst_push(&burst, LCD_1602_RESET_CURSOR_POS, false);
+        err |= lcd_1602_burst_flush(handle, &burst);
+        lcd_1602_delay_us(state, timing_of(state)->home_us);
+
+        if(state != NULL) {
+            state->cursor = err == 0 ? 0 : LCD_1602_CURSOR_UNKNOWN;
+            state->recovering = false;
+            state->resync_pending = err != 0;
+        }
+    }
+
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_ATTACH, start);
+    return err;
+}
+
+/**
+ * @brief Brings the LCD back to 4-bit mode from any nibble phase and replays the shadow.
+ * 
+ * @param state the state of the display
+ * 
+ * @return 0 for success, else for fail.
+ */
+static uint8_t resync(lcd_1602_state_t *state) {
+    i2c_master_dev_handle_t handle = state->handle;
+    lcd_1602_burst_t burst = { .len = 0 };
+    const lcd_1602_timing_t *timing = &state->timing;
+
+    state->recovering = true;
+    state->resync_pending = false;
+    LCD_1602_STATS_RESYNC(state);
+
+    // Where the display has to be shifted to again, derived so a failed resync does not lose it
+    uint8_t shift = state->page * LCD_1602_SCREEN_CHAR_WIDTH;
+#if LCD_1602_ENABLE_MARQUEE
+    if(state->marquee_running) shift = state->marquee_pos % LCD_1602_DDRAM_COLS;
+#endif
+
+    /*
+    Three 8-bit function sets end up in 8-bit mode wherever the LCD was between
+    nibbles, the fourth switches to 4-bit. The first may complete an instruction
+    the LCD was in the middle of, a return home or clear included, so it gets
+    their time like in the init sequence. A running controller executes the rest
+    in the normal instruction time, so they share one burst.
+    */
+    burst_push_nibble(&burst, (0x03 << 4), false);
+    uint8_t err = lcd_1602_burst_flush(handle, &burst);
+    lcd_1602_delay_us(state, timing->clear_us > timing->home_us ? timing->clear_us : timing->home_us);
+
+    burst_push_nibble(&burst, (0x03 << 4), false);
+    burst_push_nibble(&burst, (0x03 << 4), false);
+    burst_push_nibble(&burst, (0x02 << 4), false);
+    lcd_1602_burst_push(&burst, LCD_1602_DEFAULT_FUNCTION_SET, false);
+    lcd_1602_burst_push(&burst, LCD_1602_DEFAULT_DISPLAY_SWITCH, false);
+    lcd_1602_burst_push(&burst, LCD_1602_DEFAULT_INPUT_SET, false);
+
+    // The completed instruction may have shifted the display, return home takes it back to zero
+    lcd_1602_burst_push(&burst, LCD_1602_RESET_CURSOR_POS, false);
+    err |= lcd_1602_burst_flush(handle, &burst);
+    lcd_1602_delay_us(state, timing->home_us);
+    state->display_shift = 0;
+    state->cursor = err == 0 ? 0 : LCD_1602_CURSOR_UNKNOWN;
+
+    // Bring the page or the marquee position back on screen before replaying at its offset
+    if(err == 0) err = lcd_1602_shift_display(state, shift);
+
+    // The fault may have hit a glyph upload, the slots are rewritten from their cached bitmaps
+    if(err == 0) err = lcd_1602_glyph_restore(state);
+
+    // A marquee also scrolls in the columns off screen, so both DDRAM lines are refilled whole
+    if(err == 0 && state->marquee_running) err = lcd_1602_marquee_fill(state);
+    else if(err == 0) {
+        // Replay every row we know the content of, without clearing the display first
+        char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];
+        uint8_t rows = state->shadow_rows;
+
+        memcpy(frame, state->shadow, sizeof(frame));
+        state->shadow_rows = 0;
+
+        for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+            if(rows & (1 << row)) err |= lcd_1602_update_row(state, frame, row);
+        }
+
+#if LCD_1602_ENABLE_PAGES
+        // The hidden pages may have been hit by the same fault
+        for(uint8_t page = 0; page < LCD_1602_PAGES; page++) {
+            if(page == state->page) continue;
+
+            rows = state->page_rows[page];
+            memcpy(frame, state->page_shadow[page], sizeof(frame));
+            state->page_rows[page] = 0;
+
+            for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+                if(rows & (1 << row)) {
+                    err |= lcd_1602_draw_row(state, frame, row, state->page_shadow[page], &state->page_rows[page],
+                                             page * LCD_1602_SCREEN_CHAR_WIDTH);
+                }
+            }
+        }
+#endif
+    }
+
+    state->recovering = false;
+    if(err != 0) state->resync_pending = true;
+
+    return err;
+}
+
+uint8_t lcd_1602_shift_display(lcd_1602_state_t *state, uint8_t shift) {
+    i2c_master_dev_handle_t handle = state->handle;
+    uint8_t left = (shift + LCD_1602_DDRAM_COLS - state->display_shift) % LCD_1602_DDRAM_COLS;
+    if(left == 0) return 0;
+
+    bool go_left = left <= LCD_1602_DDRAM_COLS - left;
+    uint8_t steps = go_left ? left : LCD_1602_DDRAM_COLS - left;
+    uint8_t cmd = go_left ? LCD_1602_SHIFT(LCD_1602_DISPLAY_SHIFT, LCD_1602_SHIFT_LEFT)
+                          : LCD_1602_SHIFT(LCD_1602_DISPLAY_SHIFT, LCD_1602_SHIFT_RIGHT);
+    lcd_1602_burst_t burst = { .len = 0 };
+
+    // The display stays on: switched off, the screen would be blank for the whole burst
+    uint8_t err = 0;
+    for(uint8_t i = 0; i < steps; i++) {
+        err |= lcd_1602_burst_queue(handle, &burst, cmd, false);
+    }
+    err |= lcd_1602_burst_flush(handle, &burst);
+    lcd_1602_delay_us(state, state->timing.instr_us);
+
+    state->display_shift = shift;
+    return err;
+}
+
+uint8_t lcd_1602_recover(lcd_1602_state_t *state, uint8_t err) {
+    if(state == NULL || !state->resync_pending || state->recovering) return err;
+
+    return resync(state);
+}
+
+uint8_t lcd_1602_resync(i2c_master_dev_handle_t handle) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return 1;
+
+    lcd_1602_lock(state);
+    uint8_t err = resync(state);
+    lcd_1602_unlock(state);
+
+    return err;
+}
+
+void lcd_1602_lock(lcd_1602_state_t *state) {
+    if(state != NULL && state->lock != NULL) xSemaphoreTake(state->lock, portMAX_DELAY);
+}
+
+void lcd_1602_unlock(lcd_1602_state_t *state) {
+    if(state == NULL || state->lock == NULL) return;
+
+    xSemaphoreGive(state->lock);
+
+    // The render worker passed the display over while it was locked and waits to be woken
+    if(state->render_deferred) {
+        state->render_deferred = false;
+        lcd_1602_render_wake(state);
+    }
 }
 
 /** @} lcd_1602_driver */
\ No newline at end of file
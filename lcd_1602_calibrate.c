@@ -0,0 +1,149 @@
+/**
+ *
+ * @file:       lcd_1602_calibrate.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      SCL speed calibration with test patterns written to the DDRAM and read back.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+#define CALIBRATE_ADDR (0x40 + LCD_1602_CALIBRATE_COL)
+
+static const uint32_t speeds[] = LCD_1602_CALIBRATE_SPEEDS;
+static const uint8_t pattern[LCD_1602_CALIBRATE_LEN] = { 0x55, 0xAA, 0x33, 0xCC, 0x0F, 0xF0, 0x69, 0x96 };
+
+/**
+ * @brief Moves the display to another SCL speed and the driver state to the new handle,
+ * then resyncs the LCD if a test failed.
+ * 
+ * @return 0 for success, else for fail.
+ */
+static uint8_t switch_speed(lcd_1602_state_t *state, uint32_t scl_hz) {
+    i2c_master_dev_handle_t handle = state->handle;
+
+    lcd_1602_bus_wait(state);
+    uint8_t err = i2c_set_speed(&handle, scl_hz);
+
+    // The old handle stays the key of the display, but no transfer may use it again
+    if(handle == NULL) {
+        state->bus_lost = true;
+        return 1;
+    }
+    state->handle = handle;
+
+    // A failed test is cleaned up at the new speed, at the old one the resync would be garbled too
+    return lcd_1602_recover(state, err);
+}
+
+/**
+ * @brief Returns true if a byte clocked into the LCD at the speed takes at least the
+ * instruction time, so a burst never outruns the controller.
+ */
+static bool burst_keeps_up(const lcd_1602_state_t *state, uint32_t scl_hz) {
+    // Every byte on the bus takes 9 clocks with the ACK
+    uint64_t write_us = (uint64_t)LCD_1602_BURST_BYTES_PER_WRITE * 9 * 1000000 / scl_hz;
+    return write_us >= state->timing.instr_us;
+}
+
+/**
+ * @brief Writes the test pattern rotated by pass and reads it back.
+ * 
+ * @return 0 if every byte came back, else for fail.
+ */
+static uint8_t verify(lcd_1602_state_t *state, uint8_t pass) {
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t wanted[LCD_1602_CALIBRATE_LEN];
+    uint8_t read[LCD_1602_CALIBRATE_LEN];
+
+    for(uint8_t i = 0; i < LCD_1602_CALIBRATE_LEN; i++) {
+        wanted[i] = pattern[(i + pass) % LCD_1602_CALIBRATE_LEN];
+    }
+
+    uint8_t err = lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SET_DDRAM_ADDR | CALIBRATE_ADDR, false);
+    for(uint8_t i = 0; i < LCD_1602_CALIBRATE_LEN; i++) {
+        err |= lcd_1602_burst_queue(state->handle, &burst, wanted[i], true);
+    }
+    err |= lcd_1602_burst_flush(state->handle, &burst);
+    lcd_1602_delay_us(state, state->timing.instr_us);
+
+    if(err == 0) err = lcd_1602_read_ddram(state, CALIBRATE_ADDR, read, sizeof(read));
+    if(err == 0) err = memcmp(read, wanted, sizeof(read)) != 0;
+
+    // A corrupted byte may have been taken as an instruction or left the LCD between nibbles
+    if(err != 0) state->resync_pending = true;
+
+    return err;
+}
+
+/**
+ * @brief Tries a speed LCD_1602_CALIBRATE_MARGIN_PCT faster than scl_hz.
+ * 
+ * @return 0 if every pass came back, else for fail.
+ */
+static uint8_t try_speed(lcd_1602_state_t *state, uint32_t scl_hz) {
+    uint32_t test_hz = scl_hz + scl_hz / 100 * LCD_1602_CALIBRATE_MARGIN_PCT;
+    if(!burst_keeps_up(state, test_hz) || switch_speed(state, test_hz) != 0) return 1;
+
+    for(uint8_t pass = 0; pass < LCD_1602_CALIBRATE_PASSES; pass++) {
+        if(verify(state, pass) != 0) return 1;
+    }
+
+    return 0;
+}
+
+uint8_t lcd_1602_calibrate(i2c_master_dev_handle_t *handle, uint32_t *scl_hz) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = handle != NULL ? lcd_1602_get_state(*handle) : NULL;
+    if(state == NULL || scl_hz == NULL) return 1;
+
+    lcd_1602_lock(state);
+    if(state->marquee_running) {
+        lcd_1602_unlock(state);
+        return 1;
+    }
+
+    uint8_t err = 1;
+
+    if(*scl_hz != 0 && switch_speed(state, *scl_hz) == 0) {
+        err = verify(state, 0);
+    }
+
+    if(err != 0) {
+        uint32_t best = 0;
+
+        for(uint8_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+            if(try_speed(state, speeds[i]) != 0) break;
+            best = speeds[i];
+        }
+
+        err = best == 0;
+        *scl_hz = err ? I2C_MASTER_FREQ_HZ : best;
+        if(switch_speed(state, *scl_hz) != 0) err = 1;
+    }
+
+    // Blank the test cells again, they are shown once a marquee shifts them into view
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t bus_err = lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SET_DDRAM_ADDR | CALIBRATE_ADDR, false);
+    for(uint8_t i = 0; i < LCD_1602_CALIBRATE_LEN; i++) {
+        bus_err |= lcd_1602_burst_queue(state->handle, &burst, ' ', true);
+    }
+    bus_err |= lcd_1602_burst_flush(state->handle, &burst);
+    state->cursor = lcd_1602_addr_after(CALIBRATE_ADDR + LCD_1602_CALIBRATE_LEN - 1);
+
+#if LCD_1602_PAGES * LCD_1602_SCREEN_CHAR_WIDTH > LCD_1602_CALIBRATE_COL
+    // The test cells are part of the last page, which is rewritten from its shadow
+    state->resync_pending = true;
+#endif
+    if(lcd_1602_recover(state, bus_err) != 0) err = 1;
+
+    *handle = state->handle;
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_CALIBRATE, start);
+    return err;
+}
+
+/**@} */
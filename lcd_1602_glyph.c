@@ -0,0 +1,215 @@
+/**
+ *
+ * @file:       lcd_1602_glyph.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Custom glyphs with the CGRAM slots managed as a least recently used cache.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+/**
+ * @brief Returns true if a CGRAM bitmap holds the glyph.
+ */
+static bool glyph_equal(const uint8_t bitmap[LCD_1602_GLYPH_ROWS], const lcd_1602_glyph_t *glyph) {
+    return memcmp(bitmap, glyph->rows, LCD_1602_GLYPH_ROWS) == 0;
+}
+
+/**
+ * @brief Returns true if the cell currently shows its glyph from a CGRAM slot, false for
+ * text and for cells whose glyph was evicted.
+ */
+static bool cell_shows_glyph(const lcd_1602_state_t *state, uint8_t row, uint8_t col) {
+    return state->glyph_cells[row][col] != NULL && (uint8_t)state->shadow[row][col] < LCD_1602_GLYPH_SLOTS;
+}
+
+/**
+ * @brief Returns the CGRAM slot holding the glyph or LCD_1602_GLYPH_NONE.
+ */
+static uint8_t find_slot(const lcd_1602_state_t *state, const lcd_1602_glyph_t *glyph) {
+    for(uint8_t slot = 0; slot < LCD_1602_GLYPH_SLOTS; slot++) {
+        if((state->cgram_slots & (1 << slot)) && glyph_equal(state->cgram[slot], glyph)) return slot;
+    }
+
+    return LCD_1602_GLYPH_NONE;
+}
+
+/**
+ * @brief Picks the slot for a new glyph: a free slot, else the least recently used slot
+ * that is neither on screen nor pinned, else the least recently used slot.
+ * 
+ * @param state the state of the display
+ * @param pinned bitmask of slots the caller still needs
+ */
+static uint8_t pick_slot(const lcd_1602_state_t *state, uint8_t pinned) {
+    uint8_t visible = pinned;
+    uint8_t hidden_lru = LCD_1602_GLYPH_NONE;
+    uint8_t lru = 0;
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        for(uint8_t col = 0; col < LCD_1602_SCREEN_CHAR_WIDTH; col++) {
+            if(cell_shows_glyph(state, row, col)) visible |= 1 << state->shadow[row][col];
+        }
+    }
+
+    for(uint8_t slot = 0; slot < LCD_1602_GLYPH_SLOTS; slot++) {
+        if(!(state->cgram_slots & (1 << slot))) return slot;
+
+        if(state->cgram_used[slot] < state->cgram_used[lru]) lru = slot;
+        if(!(visible & (1 << slot)) &&
+           (hidden_lru == LCD_1602_GLYPH_NONE || state->cgram_used[slot] < state->cgram_used[hidden_lru])) {
+            hidden_lru = slot;
+        }
+    }
+
+    return hidden_lru != LCD_1602_GLYPH_NONE ? hidden_lru : lru;
+}
+
+/**
+ * @brief Appends writing a character to a cell to the burst and updates the shadow.
+ *
+ * @return 0 for success, else for fail.
+ */
+static uint8_t queue_cell(lcd_1602_state_t *state, lcd_1602_burst_t *burst, uint8_t col, uint8_t row, uint8_t c) {
+    uint8_t err = 0;
+
+    uint8_t addr = lcd_1602_cell_addr(state, col, row);
+
+    if(state->cursor != addr) {
+        err |= lcd_1602_burst_queue(state->handle, burst, LCD_1602_SET_DDRAM_ADDR | addr, false);
+    }
+    err |= lcd_1602_burst_queue(state->handle, burst, c, true);
+
+    state->shadow[row][col] = (char)c;
+    state->cursor = lcd_1602_addr_after(addr);
+
+    return err;
+}
+
+/**
+ * @brief Appends uploading a glyph to a CGRAM slot to the burst. Cells that showed the
+ * previous glyph of the slot are blanked, cells waiting for this glyph get it back.
+ *
+ * @return 0 for success, else for fail.
+ */
+static uint8_t upload(lcd_1602_state_t *state, lcd_1602_burst_t *burst, uint8_t slot, const lcd_1602_glyph_t *glyph) {
+    uint8_t err = lcd_1602_burst_queue(state->handle, burst, LCD_1602_SET_CGRAM_ADDR | (slot * LCD_1602_GLYPH_ROWS), false);
+
+    for(uint8_t i = 0; i < LCD_1602_GLYPH_ROWS; i++) {
+        err |= lcd_1602_burst_queue(state->handle, burst, glyph->rows[i], true);
+    }
+
+    memcpy(state->cgram[slot], glyph->rows, LCD_1602_GLYPH_ROWS);
+    state->cgram_slots |= 1 << slot;
+    // The address counter points into the CGRAM now
+    state->cursor = LCD_1602_CURSOR_UNKNOWN;
+    LCD_1602_STATS_GLYPH(state);
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        for(uint8_t col = 0; col < LCD_1602_SCREEN_CHAR_WIDTH; col++) {
+            const lcd_1602_glyph_t *wanted = state->glyph_cells[row][col];
+            if(wanted == NULL) continue;
+
+            bool same = glyph_equal(wanted->rows, glyph);
+            if((uint8_t)state->shadow[row][col] == slot && !same) {
+                // Showed the evicted glyph, keep the cell blank until the glyph is put again
+                err |= queue_cell(state, burst, col, row, LCD_1602_GLYPH_FALLBACK);
+            }
+            else if(!cell_shows_glyph(state, row, col) && same) {
+                err |= queue_cell(state, burst, col, row, slot);
+            }
+        }
+    }
+
+    return err;
+}
+
+uint8_t lcd_1602_glyph_restore(lcd_1602_state_t *state) {
+    if(state->cgram_slots == 0) return 0;
+
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = 0;
+
+    for(uint8_t slot = 0; slot < LCD_1602_GLYPH_SLOTS; slot++) {
+        if(!(state->cgram_slots & (1 << slot))) continue;
+
+        err |= lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SET_CGRAM_ADDR | (slot * LCD_1602_GLYPH_ROWS), false);
+        for(uint8_t i = 0; i < LCD_1602_GLYPH_ROWS; i++) {
+            err |= lcd_1602_burst_queue(state->handle, &burst, state->cgram[slot][i], true);
+        }
+    }
+    err |= lcd_1602_burst_flush(state->handle, &burst);
+
+    // The address counter points into the CGRAM now
+    state->cursor = LCD_1602_CURSOR_UNKNOWN;
+    return err;
+}
+
+void lcd_1602_glyph_release(lcd_1602_state_t *state, const char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH], uint8_t row) {
+    for(uint8_t col = 0; col < LCD_1602_SCREEN_CHAR_WIDTH; col++) {
+        if(frame[row][col] != state->shadow[row][col] || !cell_shows_glyph(state, row, col)) {
+            state->glyph_cells[row][col] = NULL;
+        }
+    }
+}
+
+uint8_t lcd_1602_put_glyphs(i2c_master_dev_handle_t handle, uint8_t x, uint8_t y, const lcd_1602_glyph_t *const glyphs[], uint8_t count) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || glyphs == NULL || y >= LCD_1602_MAX_ROWS || x + count > LCD_1602_SCREEN_CHAR_WIDTH) return 1;
+
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t pinned = 0;
+    uint8_t err = 0;
+
+    lcd_1602_lock(state);
+    if(state->marquee_running) {
+        lcd_1602_unlock(state);
+        return 1;
+    }
+
+    // The cells are overwritten below, they must not count as showing or waiting for a glyph
+    for(uint8_t i = 0; i < count; i++) {
+        if(glyphs[i] != NULL) state->glyph_cells[y][x + i] = NULL;
+    }
+
+    // Glyphs that are already resident must survive the uploads of the others
+    for(uint8_t i = 0; i < count; i++) {
+        uint8_t slot = glyphs[i] != NULL ? find_slot(state, glyphs[i]) : LCD_1602_GLYPH_NONE;
+        if(slot != LCD_1602_GLYPH_NONE) pinned |= 1 << slot;
+    }
+
+    for(uint8_t i = 0; i < count; i++) {
+        if(glyphs[i] == NULL) continue;
+
+        uint8_t slot = find_slot(state, glyphs[i]);
+        if(slot == LCD_1602_GLYPH_NONE) {
+            slot = pick_slot(state, pinned);
+            err |= upload(state, &burst, slot, glyphs[i]);
+        }
+        pinned |= 1 << slot;
+        state->cgram_used[slot] = ++state->cgram_clock;
+        state->glyph_cells[y][x + i] = glyphs[i];
+
+        if(!(state->shadow_rows & (1 << y)) || (uint8_t)state->shadow[y][x + i] != slot) {
+            err |= queue_cell(state, &burst, x + i, y, slot);
+        }
+    }
+
+    err |= lcd_1602_burst_flush(handle, &burst);
+    err = lcd_1602_recover(state, err);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_PUT_GLYPH, start);
+    return err;
+}
+
+uint8_t lcd_1602_put_glyph(i2c_master_dev_handle_t handle, uint8_t x, uint8_t y, const lcd_1602_glyph_t *glyph) {
+    if(glyph == NULL) return 1;
+
+    return lcd_1602_put_glyphs(handle, x, y, &glyph, 1);
+}
+
+/**@} */
@@ -0,0 +1,230 @@
+/**
+ *
+ * @file:       lcd_1602_marquee.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Marquee scrolling with the display shift instruction of the HD44780.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+#if LCD_1602_ENABLE_MARQUEE
+
+#if LCD_1602_MARQUEE_MAX_LEN > 255
+#error "LCD_1602_MARQUEE_MAX_LEN must fit in a uint8_t"
+#endif
+
+/**
+ * @brief Returns the length of one lap of a marquee row. Rows that fit the DDRAM line loop
+ * with the line itself, longer rows loop with LCD_1602_MARQUEE_GAP blanks after the text.
+ */
+static uint32_t lap_of(const lcd_1602_state_t *state, uint8_t row) {
+    uint32_t len = state->marquee_len[row];
+    return len <= LCD_1602_DDRAM_COLS ? LCD_1602_DDRAM_COLS : len + LCD_1602_MARQUEE_GAP;
+}
+
+/**
+ * @brief Returns the character at a position of the looped marquee row.
+ */
+static char marquee_char(const lcd_1602_state_t *state, uint8_t row, uint32_t pos) {
+    uint32_t i = pos % lap_of(state, row);
+    return i < state->marquee_len[row] ? state->marquee_text[row][i] : ' ';
+}
+
+/**
+ * @brief Copies the visible part of the marquee into the shadow.
+ */
+static void marquee_shadow(lcd_1602_state_t *state) {
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        for(uint8_t col = 0; col < LCD_1602_SCREEN_CHAR_WIDTH; col++) {
+            state->shadow[row][col] = marquee_char(state, row, state->marquee_pos + col);
+        }
+    }
+    memset(state->glyph_cells, 0, sizeof(state->glyph_cells));
+    state->shadow_rows = LCD_1602_ALL_ROWS;
+}
+
+/**
+ * @brief Timer callback that hands a step to the render worker.
+ */
+static void marquee_timer_cb(void *arg) {
+    lcd_1602_state_t *state = (lcd_1602_state_t *)arg;
+
+    state->marquee_due = true;
+    lcd_1602_render_wake(state);
+}
+
+bool lcd_1602_marquee_step(lcd_1602_state_t *state) {
+    if(!state->marquee_due) return false;
+    state->marquee_due = false;
+    if(!state->marquee_running) return false;
+
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = 0;
+
+    // After the shift the last screen column shows this position of the text
+    uint32_t entering = state->marquee_pos + LCD_1602_SCREEN_CHAR_WIDTH;
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        // The column still holds the text from one DDRAM line earlier, refill it if that differs
+        if(lap_of(state, row) == LCD_1602_DDRAM_COLS || entering < LCD_1602_DDRAM_COLS) continue;
+
+        char c = marquee_char(state, row, entering);
+        if(c == marquee_char(state, row, entering - LCD_1602_DDRAM_COLS)) continue;
+
+        uint8_t addr = lcd_1602_ddram_addr(entering % LCD_1602_DDRAM_COLS, row);
+        if(state->cursor != addr) {
+            err |= lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SET_DDRAM_ADDR | addr, false);
+        }
+        err |= lcd_1602_burst_queue(state->handle, &burst, (uint8_t)c, true);
+        state->cursor = lcd_1602_addr_after(addr);
+    }
+
+    err |= lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SHIFT(LCD_1602_DISPLAY_SHIFT, LCD_1602_SHIFT_LEFT), false);
+    err |= lcd_1602_burst_flush(state->handle, &burst);
+    lcd_1602_delay_us(state, state->timing.instr_us);
+
+    state->marquee_pos++;
+    state->display_shift = (state->display_shift + 1) % LCD_1602_DDRAM_COLS;
+    marquee_shadow(state);
+
+    lcd_1602_recover(state, err);
+    return true;
+}
+
+uint8_t lcd_1602_marquee_fill(lcd_1602_state_t *state) {
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = 0;
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        for(uint8_t col = 0; col < LCD_1602_DDRAM_COLS; col++) {
+            uint32_t pos = state->marquee_pos + col;
+
+            // Columns past the screen still hold the text from one DDRAM line earlier, once the marquee has come round
+            if(col >= LCD_1602_SCREEN_CHAR_WIDTH && pos >= LCD_1602_DDRAM_COLS) pos -= LCD_1602_DDRAM_COLS;
+
+            uint8_t addr = lcd_1602_ddram_addr((state->marquee_pos + col) % LCD_1602_DDRAM_COLS, row);
+            if(state->cursor != addr) {
+                err |= lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SET_DDRAM_ADDR | addr, false);
+            }
+            err |= lcd_1602_burst_queue(state->handle, &burst, (uint8_t)marquee_char(state, row, pos), true);
+            state->cursor = lcd_1602_addr_after(addr);
+        }
+    }
+    err |= lcd_1602_burst_flush(state->handle, &burst);
+    marquee_shadow(state);
+
+    return err;
+}
+
+uint8_t lcd_1602_marquee_start(i2c_master_dev_handle_t handle, const char *str, uint32_t step_ms) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || str == NULL || step_ms == 0 || state->render_worker == NULL) return 1;
+
+    char text[LCD_1602_MAX_ROWS][LCD_1602_MARQUEE_MAX_LEN];
+    uint8_t lens[LCD_1602_MAX_ROWS] = { 0 };
+    uint8_t row = 0;
+
+    for(const char *c = str; *c != '\0'; c++) {
+        if(*c == '\n') {
+            if(++row >= LCD_1602_MAX_ROWS) return 1;
+            continue;
+        }
+        if(lens[row] >= LCD_1602_MARQUEE_MAX_LEN) return 1;
+        text[row][lens[row]++] = *c;
+    }
+
+    lcd_1602_lock(state);
+    state->marquee_running = false;
+    if(state->marquee_timer != NULL) esp_timer_stop(state->marquee_timer);
+    state->marquee_due = false;
+
+    memcpy(state->marquee_text, text, sizeof(text));
+    memcpy(state->marquee_len, lens, sizeof(lens));
+    state->marquee_pos = 0;
+
+    // Undo any shift, then fill both DDRAM lines completely
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = lcd_1602_burst_queue(handle, &burst, LCD_1602_RESET_CURSOR_POS, false);
+    err |= lcd_1602_burst_flush(handle, &burst);
+    lcd_1602_delay_us(state, state->timing.home_us);
+
+    state->display_shift = 0;
+    state->cursor = 0;
+    lcd_1602_pages_reset(state, false);
+
+    err |= lcd_1602_marquee_fill(state);
+    err = lcd_1602_recover(state, err);
+
+    if(state->marquee_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = marquee_timer_cb,
+            .arg = state,
+            .name = "lcd_1602_marquee",
+        };
+        if(esp_timer_create(&args, &state->marquee_timer) != ESP_OK) state->marquee_timer = NULL;
+    }
+
+    state->marquee_running = state->marquee_timer != NULL &&
+                             esp_timer_start_periodic(state->marquee_timer, (uint64_t)step_ms * 1000) == ESP_OK;
+    if(!state->marquee_running) err = 1;
+    lcd_1602_unlock(state);
+
+    return err;
+}
+
+uint8_t lcd_1602_marquee_stop(i2c_master_dev_handle_t handle) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return 1;
+
+    lcd_1602_lock(state);
+    uint8_t err = 0;
+
+    if(state->marquee_running) {
+        state->marquee_running = false;
+        esp_timer_stop(state->marquee_timer);
+        state->marquee_due = false;
+
+        // Clearing also takes the display shift back to zero
+        err = lcd_1602_clear_display(handle);
+
+        // A frame the marquee interrupted lost its drawn rows to the clear
+        if(state->render_rows != 0) state->render_rows = LCD_1602_ALL_ROWS;
+    }
+    lcd_1602_unlock(state);
+
+    // Frames submitted before or during the marquee are drawn now
+    lcd_1602_render_wake(state);
+
+    return err;
+}
+
+#else
+
+bool lcd_1602_marquee_step(lcd_1602_state_t *state) {
+    (void)state;
+    return false;
+}
+
+uint8_t lcd_1602_marquee_fill(lcd_1602_state_t *state) {
+    (void)state;
+    return 0;
+}
+
+uint8_t lcd_1602_marquee_start(i2c_master_dev_handle_t handle, const char *str, uint32_t step_ms) {
+    (void)handle;
+    (void)str;
+    (void)step_ms;
+    return 1;
+}
+
+uint8_t lcd_1602_marquee_stop(i2c_master_dev_handle_t handle) {
+    (void)handle;
+    return 1;
+}
+
+#endif
+
+/**@} */
@@ -0,0 +1,133 @@
+/**
+ *
+ * @file:       lcd_1602_page.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Double buffered pages in the off-screen part of the DDRAM lines.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+#if LCD_1602_ENABLE_PAGES
+
+#if LCD_1602_PAGES < 2
+#error "LCD_1602_SCREEN_CHAR_WIDTH leaves no room for a hidden page in the DDRAM lines"
+#endif
+
+void lcd_1602_pages_reset(lcd_1602_state_t *state, bool cleared) {
+    if(cleared) memset(state->page_shadow, ' ', sizeof(state->page_shadow));
+    memset(state->page_rows, cleared ? LCD_1602_ALL_ROWS : 0, sizeof(state->page_rows));
+    state->page = 0;
+}
+
+/**
+ * @brief Draws a string on a page that is not on screen, see lcd_1602_page_write.
+ */
+static LCD_WRITE_STATUS write_hidden(lcd_1602_state_t *state, uint8_t page, const char *str) {
+    char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];
+    uint8_t lens[LCD_1602_MAX_ROWS];
+
+    LCD_WRITE_STATUS status = lcd_1602_layout_text(str, frame, lens);
+    uint8_t err = 0;
+
+    // A hidden page always starts at the same DDRAM column, whatever the display shift
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        err |= lcd_1602_draw_row(state, frame, row, state->page_shadow[page], &state->page_rows[page],
+                                 page * LCD_1602_SCREEN_CHAR_WIDTH);
+    }
+
+    if(lcd_1602_recover(state, err) != 0) status = LCD_WRITE_ERROR;
+
+    return status;
+}
+
+LCD_WRITE_STATUS lcd_1602_page_write(i2c_master_dev_handle_t handle, uint8_t page, const char *str) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || page >= LCD_1602_PAGES) return LCD_WRITE_NOT_FINISHED;
+
+    lcd_1602_lock(state);
+    if(state->marquee_running) {
+        lcd_1602_unlock(state);
+        return LCD_WRITE_NOT_FINISHED;
+    }
+
+    LCD_WRITE_STATUS status = page == state->page ? lcd_1602_update_text(state, str) : write_hidden(state, page, str);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_PAGE_WRITE, start);
+    return status;
+}
+
+/**
+ * @brief Brings a page on screen, see lcd_1602_page_show.
+ */
+static uint8_t show(lcd_1602_state_t *state, uint8_t page) {
+    i2c_master_dev_handle_t handle = state->handle;
+    uint8_t offset = page * LCD_1602_SCREEN_CHAR_WIDTH;
+    if(page == state->page && state->display_shift == offset) return 0;
+
+    // The page leaving the screen keeps its content with the hidden pages
+    memcpy(state->page_shadow[state->page], state->shadow, sizeof(state->shadow));
+    state->page_rows[state->page] = state->shadow_rows;
+
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = 0;
+
+    if(offset == 0) {
+        err |= lcd_1602_burst_queue(handle, &burst, LCD_1602_RESET_CURSOR_POS, false);
+        err |= lcd_1602_burst_flush(handle, &burst);
+        lcd_1602_delay_us(state, state->timing.home_us);
+        state->cursor = 0;
+    }
+    else {
+        err |= lcd_1602_shift_display(state, offset);
+    }
+
+    state->display_shift = offset;
+    state->page = page;
+    memcpy(state->shadow, state->page_shadow[page], sizeof(state->shadow));
+    state->shadow_rows = state->page_rows[page];
+    memset(state->glyph_cells, 0, sizeof(state->glyph_cells));
+
+    return lcd_1602_recover(state, err);
+}
+
+uint8_t lcd_1602_page_show(i2c_master_dev_handle_t handle, uint8_t page) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || page >= LCD_1602_PAGES) return 1;
+
+    lcd_1602_lock(state);
+    uint8_t err = state->marquee_running ? 1 : show(state, page);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_PAGE_SHOW, start);
+    return err;
+}
+
+#else
+
+void lcd_1602_pages_reset(lcd_1602_state_t *state, bool cleared) {
+    (void)cleared;
+    state->page = 0;
+}
+
+LCD_WRITE_STATUS lcd_1602_page_write(i2c_master_dev_handle_t handle, uint8_t page, const char *str) {
+    (void)handle;
+    (void)page;
+    (void)str;
+    return LCD_WRITE_NOT_FINISHED;
+}
+
+uint8_t lcd_1602_page_show(i2c_master_dev_handle_t handle, uint8_t page) {
+    (void)handle;
+    (void)page;
+    return 1;
+}
+
+#endif
+
+/**@} */
@@ -0,0 +1,214 @@
+/**
+ *
+ * @file:       lcd_1602_region.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Regions of the screen updated by separate tasks and drawn together.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+#if LCD_1602_ENABLE_REGIONS
+
+#if LCD_1602_MAX_REGIONS > 32
+#error "LCD_1602_MAX_REGIONS must fit in the uint32_t dirty mask"
+#endif
+
+static portMUX_TYPE regions_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Timer callback that hands rate limited regions that are due to the render worker.
+ */
+static void region_timer_cb(void *arg) {
+    lcd_1602_state_t *state = (lcd_1602_state_t *)arg;
+
+    if(state->render_worker != NULL) lcd_1602_render_wake(state);
+}
+
+uint8_t lcd_1602_region_add(i2c_master_dev_handle_t handle, uint8_t row, uint8_t col, uint8_t width, uint32_t max_hz, lcd_1602_region_t *region) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || region == NULL || row >= LCD_1602_MAX_ROWS || width == 0 || col + width > LCD_1602_SCREEN_CHAR_WIDTH) return 1;
+
+    uint8_t err = 0;
+
+    // The render worker arms the timer under the lock, so it must not see it half created
+    lcd_1602_lock(state);
+    if(max_hz > 0 && state->region_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = region_timer_cb,
+            .arg = state,
+            .name = "lcd_1602_region",
+        };
+        if(esp_timer_create(&args, &state->region_timer) != ESP_OK) {
+            state->region_timer = NULL;
+            err = 1;
+        }
+    }
+    lcd_1602_unlock(state);
+    if(err != 0) return err;
+
+    taskENTER_CRITICAL(&regions_lock);
+    for(uint8_t i = 0; i < state->region_count; i++) {
+        const lcd_1602_region_state_t *other = &state->regions[i];
+        if(other->row == row && col < other->col + other->width && other->col < col + width) err = 1;
+    }
+
+    if(err == 0 && state->region_count < LCD_1602_MAX_REGIONS) {
+        lcd_1602_region_state_t *r = &state->regions[state->region_count];
+
+        *r = (lcd_1602_region_state_t){
+            .row = row,
+            .col = col,
+            .width = width,
+            .min_us = max_hz > 0 ? 1000000 / max_hz : 0,
+            .back = 0,
+            .latest = 1,
+            .front = 2,
+        };
+        memset(r->text, ' ', sizeof(r->text));
+        *region = state->region_count++;
+    }
+    else err = 1;
+    taskEXIT_CRITICAL(&regions_lock);
+
+    return err;
+}
+
+LCD_WRITE_STATUS lcd_1602_region_set(i2c_master_dev_handle_t handle, lcd_1602_region_t region, const char *str) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || str == NULL || region >= state->region_count) return LCD_WRITE_INTERRUPTED;
+
+    lcd_1602_region_state_t *r = &state->regions[region];
+    char *text = r->text[r->back];
+    LCD_WRITE_STATUS status = LCD_WRITE_NOT_FINISHED;
+    uint8_t len = 0;
+
+    while(len < r->width && str[len] != '\0') len++;
+    if(str[len] != '\0') status = LCD_TOO_LONG_STRING;
+
+    memcpy(text, str, len);
+    memset(text + len, ' ', r->width - len);
+
+    // Publish the filled buffer and take the one it replaces, then flag the region for the drawer
+    r->back = __atomic_exchange_n(&r->latest, r->back | LCD_1602_REGION_FRESH, __ATOMIC_ACQ_REL) & ~LCD_1602_REGION_FRESH;
+    __atomic_fetch_or(&state->region_dirty, 1UL << region, __ATOMIC_RELEASE);
+
+    if(state->render_worker != NULL) lcd_1602_render_wake(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_REGION_SET, start);
+    return status;
+}
+
+bool lcd_1602_region_step(lcd_1602_state_t *state, uint8_t *err) {
+    *err = 0;
+
+    uint32_t dirty = __atomic_load_n(&state->region_dirty, __ATOMIC_ACQUIRE);
+    if(dirty == 0 || state->marquee_running) return false;
+
+    char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH];
+    int64_t now = esp_timer_get_time();
+    int64_t wait_us = -1;
+    uint8_t rows = 0;
+
+    // Rows that were never drawn only get their regions, the rest of the row is blanked
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        if(state->shadow_rows & (1 << row)) memcpy(frame[row], state->shadow[row], sizeof(frame[row]));
+        else memset(frame[row], ' ', sizeof(frame[row]));
+    }
+
+    for(uint8_t i = 0; i < state->region_count; i++) {
+        if(!(dirty & (1UL << i))) continue;
+        lcd_1602_region_state_t *r = &state->regions[i];
+
+        int64_t left = r->drawn_us + r->min_us - now;
+        if(r->min_us != 0 && r->drawn_us != 0 && left > 0) {
+            if(wait_us < 0 || left < wait_us) wait_us = left;
+            continue;
+        }
+
+        // Cleared before taking the text, so a set in between is drawn on the next pass
+        __atomic_fetch_and(&state->region_dirty, ~(1UL << i), __ATOMIC_ACQ_REL);
+        if(__atomic_load_n(&r->latest, __ATOMIC_ACQUIRE) & LCD_1602_REGION_FRESH) {
+            r->front = __atomic_exchange_n(&r->latest, r->front, __ATOMIC_ACQ_REL) & ~LCD_1602_REGION_FRESH;
+        }
+
+        memcpy(&frame[r->row][r->col], r->text[r->front], r->width);
+        r->drawn_us = now;
+        rows |= 1 << r->row;
+    }
+
+    for(uint8_t row = 0; row < LCD_1602_MAX_ROWS; row++) {
+        if(rows & (1 << row)) *err |= lcd_1602_update_row(state, frame, row);
+    }
+    *err = lcd_1602_recover(state, *err);
+
+    if(wait_us > 0 && state->region_timer != NULL && state->render_worker != NULL) {
+        esp_timer_stop(state->region_timer);
+        esp_timer_start_once(state->region_timer, (uint64_t)wait_us);
+    }
+
+    return rows != 0;
+}
+
+void lcd_1602_region_overlay(const lcd_1602_state_t *state, char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH]) {
+    for(uint8_t i = 0; i < state->region_count; i++) {
+        const lcd_1602_region_state_t *r = &state->regions[i];
+        if(r->drawn_us != 0) memcpy(&frame[r->row][r->col], r->text[r->front], r->width);
+    }
+}
+
+uint8_t lcd_1602_region_flush(i2c_master_dev_handle_t handle) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || state->render_worker != NULL) return 1;
+
+    uint8_t err;
+    lcd_1602_lock(state);
+    lcd_1602_region_step(state, &err);
+    lcd_1602_unlock(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_REGION_FLUSH, start);
+    return err;
+}
+
+#else
+
+uint8_t lcd_1602_region_add(i2c_master_dev_handle_t handle, uint8_t row, uint8_t col, uint8_t width, uint32_t max_hz, lcd_1602_region_t *region) {
+    (void)handle;
+    (void)row;
+    (void)col;
+    (void)width;
+    (void)max_hz;
+    (void)region;
+    return 1;
+}
+
+LCD_WRITE_STATUS lcd_1602_region_set(i2c_master_dev_handle_t handle, lcd_1602_region_t region, const char *str) {
+    (void)handle;
+    (void)region;
+    (void)str;
+    return LCD_WRITE_INTERRUPTED;
+}
+
+bool lcd_1602_region_step(lcd_1602_state_t *state, uint8_t *err) {
+    (void)state;
+    *err = 0;
+    return false;
+}
+
+void lcd_1602_region_overlay(const lcd_1602_state_t *state, char frame[LCD_1602_MAX_ROWS][LCD_1602_SCREEN_CHAR_WIDTH]) {
+    (void)state;
+    (void)frame;
+}
+
+uint8_t lcd_1602_region_flush(i2c_master_dev_handle_t handle) {
+    (void)handle;
+    return 1;
+}
+
+#endif
+
+/**@} */
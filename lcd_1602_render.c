@@ -0,0 +1,284 @@
+/**
+ *
+ * @file:       lcd_1602_render.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Driver owned render tasks for non-blocking, latest-wins screen updates.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+/**
+ * @brief A render task and the displays it draws. Displays sharing a bus share one worker
+ * that takes turns between them one row at a time, so a long redraw on one display can not
+ * starve the others.
+ */
+typedef struct lcd_1602_render_worker {
+    const void *key;                                        /**< Bus the worker serves, or the display state for unmanaged handles */
+    TaskHandle_t task;                                      /**< The render task */
+    lcd_1602_state_t *displays[LCD_1602_MAX_DISPLAYS];      /**< Displays served by the worker */
+    uint8_t count;                                          /**< Displays used in displays */
+    uint8_t next;                                           /**< Display that gets the next turn */
+} lcd_1602_render_worker_t;
+
+static lcd_1602_render_worker_t workers[LCD_1602_MAX_DISPLAYS];
+static portMUX_TYPE workers_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Returns true if sequence number a is before b, handling wrap around.
+ */
+static bool seq_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+/**
+ * @brief Takes a due marquee step, draws the changed regions, draws one row of the
+ * display's pending frame or runs a due scrub cycle. A frame submitted while another is
+ * being drawn replaces it, rows already drawn are only touched again if they differ.
+ * 
+ * @param state the display to take a turn for
+ * 
+ * @return true if anything was drawn.
+ */
+static bool render_step(lcd_1602_state_t *state) {
+    lcd_1602_frame_t frame;
+    uint8_t err;
+
+    if(lcd_1602_marquee_step(state)) return true;
+    if(lcd_1602_region_step(state, &err)) return true;
+
+    // Frames wait for the marquee to stop, it owns the whole display until then
+    if(state->marquee_running) return false;
+
+    if(xQueueReceive(state->render_queue, &frame, 0) == pdTRUE) {
+        uint8_t lens[LCD_1602_MAX_ROWS];
+        lcd_1602_layout_text(frame.text, state->render_frame, lens);
+        state->render_rows = LCD_1602_ALL_ROWS;
+        state->render_seq = frame.seq;
+    }
+
+    // Scrubbing only gets the turns nothing else needs
+    if(state->render_rows == 0) return lcd_1602_scrub_step(state);
+
+    uint8_t row = 0;
+    while(!(state->render_rows & (1 << row))) row++;
+
+    // Regions win over frames, a region drawn since the frame was laid out is not undone
+    lcd_1602_region_overlay(state, state->render_frame);
+    lcd_1602_recover(state, lcd_1602_update_row(state, state->render_frame, row));
+    state->render_rows &= ~(1 << row);
+
+    if(state->render_rows == 0) {
+        state->rendered = state->render_seq;
+
+        // Submissions clear the bit under the same lock, so it is only ever set with nothing left to draw
+        xSemaphoreTake(state->submit_lock, portMAX_DELAY);
+        if(state->rendered == state->submitted) xEventGroupSetBits(state->render_events, LCD_1602_RENDER_DONE_BIT);
+        xSemaphoreGive(state->submit_lock);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Takes a turn for a display unless a blocking call holds its lock. The flag is set
+ * before trying, so the call either sees it when it unlocks and wakes the task, or has
+ * unlocked already and the try succeeds.
+ * 
+ * @param state the display to take a turn for
+ * 
+ * @return true if anything was drawn.
+ */
+static bool render_turn(lcd_1602_state_t *state) {
+    state->render_deferred = true;
+    if(state->lock != NULL && xSemaphoreTake(state->lock, 0) != pdTRUE) return false;
+    state->render_deferred = false;
+
+    bool worked = render_step(state);
+
+    if(state->lock != NULL) xSemaphoreGive(state->lock);
+    return worked;
+}
+
+/**
+ * @brief Task that gives every display with pending work one row per turn, round-robin.
+ * 
+ * @param arg the lcd_1602_render_worker_t to run
+ */
+static void render_task(void *arg) {
+    lcd_1602_render_worker_t *worker = (lcd_1602_render_worker_t *)arg;
+
+    for(;;) {
+        bool worked = false;
+        uint8_t count = worker->count;
+
+        for(uint8_t i = 0; i < count; i++) {
+            uint8_t idx = (worker->next + i) % count;
+
+            if(render_turn(worker->displays[idx])) {
+                worker->next = (idx + 1) % count;
+                worked = true;
+                break;
+            }
+        }
+
+        // Submissions notify the task, so nothing is lost between the scan above and sleeping
+        if(!worked) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Finds the worker for a key and adds the display to it, claiming a free worker on first use.
+ * 
+ * @param[out] first true if the display is the first of the worker, which then starts its task
+ * 
+ * @return the worker or NULL if there are no free workers.
+ */
+static lcd_1602_render_worker_t *attach_worker(const void *key, lcd_1602_state_t *state, bool *first) {
+    lcd_1602_render_worker_t *worker = NULL;
+
+    taskENTER_CRITICAL(&workers_lock);
+    for(uint8_t i = 0; i < LCD_1602_MAX_DISPLAYS && worker == NULL; i++) {
+        if(workers[i].key == key) worker = &workers[i];
+    }
+    for(uint8_t i = 0; i < LCD_1602_MAX_DISPLAYS && worker == NULL; i++) {
+        if(workers[i].key == NULL) {
+            worker = &workers[i];
+            worker->key = key;
+        }
+    }
+    if(worker != NULL && worker->count < LCD_1602_MAX_DISPLAYS) {
+        *first = worker->count == 0;
+        worker->displays[worker->count] = state;
+        worker->count++;
+    }
+    else worker = NULL;
+    taskEXIT_CRITICAL(&workers_lock);
+
+    return worker;
+}
+
+/**
+ * @brief Takes the display off the worker again, releasing the worker if it was the last one.
+ */
+static void detach_worker(lcd_1602_render_worker_t *worker, lcd_1602_state_t *state) {
+    taskENTER_CRITICAL(&workers_lock);
+    for(uint8_t i = 0; i < worker->count; i++) {
+        if(worker->displays[i] != state) continue;
+
+        worker->count--;
+        memmove(&worker->displays[i], &worker->displays[i + 1], (worker->count - i) * sizeof(worker->displays[0]));
+        break;
+    }
+    if(worker->count == 0) {
+        worker->task = NULL;
+        worker->next = 0;
+        worker->key = NULL;
+    }
+    taskEXIT_CRITICAL(&workers_lock);
+}
+
+void lcd_1602_render_wake(lcd_1602_state_t *state) {
+    // Displays joining a worker can be woken before the first display has started its task
+    TaskHandle_t task = state->render_worker->task;
+    if(task != NULL) xTaskNotifyGive(task);
+}
+
+uint8_t lcd_1602_render_start(i2c_master_dev_handle_t handle, UBaseType_t priority) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return 1;
+
+    // Concurrent starts would both create the objects and attach the display twice
+    lcd_1602_lock(state);
+    if(state->render_worker != NULL) {
+        lcd_1602_unlock(state);
+        return 0;
+    }
+
+    state->render_queue = xQueueCreate(1, sizeof(lcd_1602_frame_t));
+    state->render_events = xEventGroupCreate();
+    state->submit_lock = xSemaphoreCreateMutex();
+
+    if(state->render_queue == NULL || state->render_events == NULL || state->submit_lock == NULL) goto fail;
+
+    state->submitted = 0;
+    state->rendered = 0;
+    state->render_rows = 0;
+    xEventGroupSetBits(state->render_events, LCD_1602_RENDER_DONE_BIT);
+
+    // Displays on a managed bus share its worker, anything else gets a worker of its own
+    lcd_i2c_bus_t *bus = i2c_get_bus(handle);
+    bool first = false;
+    lcd_1602_render_worker_t *worker = attach_worker(bus != NULL ? (const void *)bus : (const void *)state, state, &first);
+    if(worker == NULL) goto fail;
+
+    if(first &&
+       xTaskCreate(render_task, "lcd_1602_render", LCD_1602_RENDER_STACK_SIZE, worker, priority, &worker->task) != pdPASS) {
+        detach_worker(worker, state);
+        goto fail;
+    }
+
+    state->render_worker = worker;
+    lcd_1602_unlock(state);
+
+    return 0;
+
+fail:
+    if(state->render_queue != NULL) vQueueDelete(state->render_queue);
+    if(state->render_events != NULL) vEventGroupDelete(state->render_events);
+    if(state->submit_lock != NULL) vSemaphoreDelete(state->submit_lock);
+    state->render_queue = NULL;
+    state->render_events = NULL;
+    state->submit_lock = NULL;
+    lcd_1602_unlock(state);
+    return 1;
+}
+
+LCD_WRITE_STATUS lcd_1602_submit(i2c_master_dev_handle_t handle, const char *str) {
+    LCD_1602_STATS_START(start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || state->render_worker == NULL || state->marquee_running) return LCD_WRITE_INTERRUPTED;
+
+    size_t len = strlen(str);
+    if(len >= LCD_1602_FRAME_TEXT_LEN) return LCD_TOO_LONG_STRING;
+
+    lcd_1602_frame_t frame;
+    memcpy(frame.text, str, len + 1);
+
+    // Numbering and queueing must happen together or an older frame could overwrite a newer one
+    xSemaphoreTake(state->submit_lock, portMAX_DELAY);
+    frame.seq = ++state->submitted;
+    xEventGroupClearBits(state->render_events, LCD_1602_RENDER_DONE_BIT);
+    xQueueOverwrite(state->render_queue, &frame);
+    xSemaphoreGive(state->submit_lock);
+
+    lcd_1602_render_wake(state);
+
+    LCD_1602_STATS_API(state, LCD_1602_API_SUBMIT, start);
+    return LCD_WRITE_NOT_FINISHED;
+}
+
+uint8_t lcd_1602_flush(i2c_master_dev_handle_t handle, TickType_t timeout) {
+    LCD_1602_STATS_START(call_start);
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || state->render_worker == NULL) return 1;
+
+    uint32_t target = state->submitted;
+    TickType_t start = xTaskGetTickCount();
+
+    while(seq_before(state->rendered, target)) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if(timeout != portMAX_DELAY && elapsed >= timeout) return 1;
+
+        // Only submit clears the bit, a flusher clearing it could take the wakeup of another
+        xEventGroupWaitBits(state->render_events, LCD_1602_RENDER_DONE_BIT, pdFALSE, pdFALSE,
+                            timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+    }
+
+    LCD_1602_STATS_API(state, LCD_1602_API_FLUSH, call_start);
+    return 0;
+}
+
+/** @} lcd_1602_driver */
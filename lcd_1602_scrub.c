@@ -0,0 +1,282 @@
+/**
+ *
+ * @file:       lcd_1602_scrub.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Background DDRAM scrub that reads the display back and repairs differing cells.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+#if LCD_1602_ENABLE_SCRUB
+
+#define SCRUB_CELLS (LCD_1602_PAGES_KEPT * LCD_1602_MAX_ROWS * LCD_1602_SCREEN_CHAR_WIDTH)
+#define SCRUB_READ_BYTES 12     /**< Bytes on the bus to read a cell, five transfers each with its address byte */
+
+static portMUX_TYPE scrub_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Timer callback that hands a scrub cycle to the render worker.
+ */
+static void scrub_timer_cb(void *arg) {
+    lcd_1602_state_t *state = (lcd_1602_state_t *)arg;
+
+    state->scrub_due = true;
+    lcd_1602_render_wake(state);
+}
+
+/**
+ * @brief Returns the DDRAM column the first screen column of a page is stored at.
+ */
+static uint8_t page_offset(const lcd_1602_state_t *state, uint8_t page) {
+    return page == state->page ? state->display_shift : page * LCD_1602_SCREEN_CHAR_WIDTH;
+}
+
+/**
+ * @brief Returns what the driver last wrote to a row of a page, the page on screen lives in shadow.
+ */
+static const char *page_row(const lcd_1602_state_t *state, uint8_t page, uint8_t row) {
+#if LCD_1602_ENABLE_PAGES
+    if(page != state->page) return state->page_shadow[page][row];
+#else
+    (void)page;
+#endif
+    return state->shadow[row];
+}
+
+/**
+ * @brief Returns the bitmask of rows of a page whose content is known.
+ */
+static uint8_t page_known_rows(const lcd_1602_state_t *state, uint8_t page) {
+#if LCD_1602_ENABLE_PAGES
+    if(page != state->page) return state->page_rows[page];
+#else
+    (void)page;
+#endif
+    return state->shadow_rows;
+}
+
+/**
+ * @brief Estimates the longest a scrub cycle can take at the speed of the display: every
+ * cell read is rewritten, each after a jump, and the cycle also re-synchronizes the LCD once,
+ * which shifts the display back and replays the screen and the hidden pages.
+ * 
+ * @param state the state of the display
+ * @param max_cells cells read per cycle
+ * 
+ * @return the time in ms, rounded up.
+ */
+static uint32_t cycle_ms(const lcd_1602_state_t *state, uint8_t max_cells) {
+    const lcd_1602_timing_t *timing = &state->timing;
+    uint32_t scl_hz = i2c_get_speed(state->handle);
+    if(scl_hz == 0) scl_hz = I2C_MASTER_FREQ_HZ;
+
+    // A cycle ends when it has been round every page once
+    uint16_t cells = max_cells < SCRUB_CELLS ? max_cells : SCRUB_CELLS;
+    uint64_t bytes = (uint64_t)cells * (SCRUB_READ_BYTES + 2 * LCD_1602_PCF_BYTE_LEN);
+    // The resync: four nibbles, four instructions, half a DDRAM line of shifts between two display
+    // switches, and every cell of every page with an address jump per row
+    uint64_t resync_bytes = 4 * LCD_1602_PCF_NIBBLE_LEN +
+                            (4 + LCD_1602_DDRAM_COLS / 2 + 2 + SCRUB_CELLS + LCD_1602_PAGES_KEPT * LCD_1602_MAX_ROWS) * LCD_1602_PCF_BYTE_LEN;
+
+    // Every byte on the bus takes 9 clocks with the ACK, each run of cells waits for its address
+    uint64_t us = (bytes + resync_bytes) * 9 * 1000000 / scl_hz;
+    us += (uint64_t)cells * timing->instr_us;
+    us += (timing->clear_us > timing->home_us ? timing->clear_us : timing->home_us) + timing->home_us + timing->instr_us;
+
+    return (uint32_t)((us + 999) / 1000);
+}
+
+/**
+ * @brief Reads a run of cells of one row back and rewrites the ones that differ.
+ * 
+ * @param state the state of the display
+ * @param page page the row belongs to
+ * @param row the row
+ * @param col first column of the run
+ * @param len cells in the run, all on the same DDRAM line
+ * @param[in,out] found counters of the cycle
+ * 
+ * @return 0 for success, else for fail.
+ */
+static uint8_t scrub_run(lcd_1602_state_t *state, uint8_t page, uint8_t row, uint8_t col, uint8_t len, lcd_1602_scrub_stats_t *found) {
+    const char *expected = &page_row(state, page, row)[col];
+    const uint8_t offset = page_offset(state, page);
+    uint8_t addr = lcd_1602_ddram_addr(col + offset, row);
+    uint8_t read[LCD_1602_SCREEN_CHAR_WIDTH];
+    uint8_t differ = 0;
+
+    if(lcd_1602_read_ddram(state, addr, read, len) != 0) {
+        found->read_errors++;
+        return 1;
+    }
+    found->cells_read += len;
+
+    for(uint8_t i = 0; i < len; i++) {
+        if(read[i] != (uint8_t)expected[i]) differ++;
+    }
+    if(differ == 0) return 0;
+    found->mismatches += differ;
+
+    // A controller between nibbles garbles nearly every cell, rewriting them one by one would not help
+    if(len >= LCD_1602_SCRUB_DESYNC_MIN && differ * 100 > len * LCD_1602_SCRUB_DESYNC_PCT) {
+        found->resyncs++;
+        state->resync_pending = true;
+        return lcd_1602_recover(state, 0);
+    }
+
+    lcd_1602_burst_t burst = { .len = 0 };
+    uint8_t err = 0;
+
+    for(uint8_t i = 0; i < len; i++) {
+        if(read[i] == (uint8_t)expected[i]) continue;
+        uint8_t cell = lcd_1602_ddram_addr(col + offset + i, row);
+
+        if(state->cursor != cell) {
+            err |= lcd_1602_burst_queue(state->handle, &burst, LCD_1602_SET_DDRAM_ADDR | cell, false);
+        }
+        err |= lcd_1602_burst_queue(state->handle, &burst, (uint8_t)expected[i], true);
+        state->cursor = lcd_1602_addr_after(cell);
+        found->repairs++;
+    }
+    err |= lcd_1602_burst_flush(state->handle, &burst);
+
+    return err;
+}
+
+bool lcd_1602_scrub_step(lcd_1602_state_t *state) {
+    if(!state->scrub_due) return false;
+    state->scrub_due = false;
+    if(!state->scrub_running || state->marquee_running) return false;
+
+    lcd_1602_scrub_stats_t found = { .cycles = 1 };
+    uint8_t err = 0;
+
+    // Rows whose content the driver does not know are skipped without using up the budget
+    for(uint16_t visited = 0; visited < SCRUB_CELLS && found.cells_read < state->scrub_max_cells && err == 0;) {
+        uint16_t pos = state->scrub_pos;
+        uint8_t col = pos % LCD_1602_SCREEN_CHAR_WIDTH;
+        uint8_t row = (pos / LCD_1602_SCREEN_CHAR_WIDTH) % LCD_1602_MAX_ROWS;
+        uint8_t page = pos / (LCD_1602_SCREEN_CHAR_WIDTH * LCD_1602_MAX_ROWS);
+        uint8_t rows = page_known_rows(state, page);
+
+        // Runs end with the row, the budget and where the row wraps around the DDRAM line
+        uint8_t start = (col + page_offset(state, page)) % LCD_1602_DDRAM_COLS;
+        uint8_t len = LCD_1602_SCREEN_CHAR_WIDTH - col;
+        if(len > LCD_1602_DDRAM_COLS - start) len = LCD_1602_DDRAM_COLS - start;
+        if((rows & (1 << row)) && len > state->scrub_max_cells - found.cells_read) len = state->scrub_max_cells - found.cells_read;
+
+        state->scrub_pos = (pos + len) % SCRUB_CELLS;
+        visited += len;
+
+        if(rows & (1 << row)) err = scrub_run(state, page, row, col, len, &found);
+    }
+
+    lcd_1602_recover(state, err);
+
+    // Ticks that came while the cycle ran are skipped, not run back to back
+    state->scrub_due = false;
+
+    taskENTER_CRITICAL(&scrub_lock);
+    state->scrub_stats.cycles += found.cycles;
+    state->scrub_stats.cells_read += found.cells_read;
+    state->scrub_stats.mismatches += found.mismatches;
+    state->scrub_stats.repairs += found.repairs;
+    state->scrub_stats.resyncs += found.resyncs;
+    state->scrub_stats.read_errors += found.read_errors;
+    taskEXIT_CRITICAL(&scrub_lock);
+
+    return true;
+}
+
+uint8_t lcd_1602_scrub_start(i2c_master_dev_handle_t handle, uint32_t period_ms, uint8_t max_cells) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || period_ms == 0 || max_cells == 0 || state->render_worker == NULL) return 1;
+
+    lcd_1602_lock(state);
+    uint8_t err = 0;
+
+    // A shorter period would start the next cycle as soon as one ends and starve the other tasks
+    uint32_t min_ms = cycle_ms(state, max_cells);
+    if(period_ms < min_ms) period_ms = min_ms;
+
+    state->scrub_running = false;
+    if(state->scrub_timer != NULL) esp_timer_stop(state->scrub_timer);
+    state->scrub_due = false;
+    state->scrub_max_cells = max_cells;
+
+    if(state->scrub_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = scrub_timer_cb,
+            .arg = state,
+            .name = "lcd_1602_scrub",
+        };
+        if(esp_timer_create(&args, &state->scrub_timer) != ESP_OK) state->scrub_timer = NULL;
+    }
+
+    state->scrub_running = state->scrub_timer != NULL &&
+                           esp_timer_start_periodic(state->scrub_timer, (uint64_t)period_ms * 1000) == ESP_OK;
+    if(!state->scrub_running) err = 1;
+    lcd_1602_unlock(state);
+
+    return err;
+}
+
+uint8_t lcd_1602_scrub_stop(i2c_master_dev_handle_t handle) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL) return 1;
+
+    lcd_1602_lock(state);
+    if(state->scrub_running) {
+        state->scrub_running = false;
+        esp_timer_stop(state->scrub_timer);
+        state->scrub_due = false;
+    }
+    lcd_1602_unlock(state);
+
+    return 0;
+}
+
+uint8_t lcd_1602_get_scrub_stats(i2c_master_dev_handle_t handle, lcd_1602_scrub_stats_t *stats, bool reset) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || stats == NULL) return 1;
+
+    taskENTER_CRITICAL(&scrub_lock);
+    *stats = state->scrub_stats;
+    if(reset) memset(&state->scrub_stats, 0, sizeof(state->scrub_stats));
+    taskEXIT_CRITICAL(&scrub_lock);
+
+    return 0;
+}
+
+#else
+
+bool lcd_1602_scrub_step(lcd_1602_state_t *state) {
+    (void)state;
+    return false;
+}
+
+uint8_t lcd_1602_scrub_start(i2c_master_dev_handle_t handle, uint32_t period_ms, uint8_t max_cells) {
+    (void)handle;
+    (void)period_ms;
+    (void)max_cells;
+    return 1;
+}
+
+uint8_t lcd_1602_scrub_stop(i2c_master_dev_handle_t handle) {
+    (void)handle;
+    return 1;
+}
+
+uint8_t lcd_1602_get_scrub_stats(i2c_master_dev_handle_t handle, lcd_1602_scrub_stats_t *stats, bool reset) {
+    (void)handle;
+    (void)stats;
+    (void)reset;
+    return 1;
+}
+
+#endif
+
+/**@} */
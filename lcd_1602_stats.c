@@ -0,0 +1,132 @@
+/**
+ *
+ * @file:       lcd_1602_stats.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Per display performance counters and latency histograms.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <stddef.h>
+#include <string.h>
+
+#if LCD_1602_ENABLE_STATS
+
+/**
+ * @brief Returns the histogram bucket for a latency, the log2 of it rounded up.
+ */
+static uint8_t bucket_of(uint32_t us) {
+    uint8_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    return bucket < LCD_1602_STATS_BUCKETS ? bucket : LCD_1602_STATS_BUCKETS - 1;
+}
+
+/**
+ * @brief Counts a failed transaction, the caller holds stats_lock.
+ */
+static void count_error(lcd_1602_stats_t *stats, esp_err_t err) {
+    stats->errors++;
+
+    // Count by code, codes that do not get a slot of their own end up in the last one
+    for(uint8_t i = 0; i < LCD_1602_STATS_ERROR_CODES; i++) {
+        if(stats->error_codes[i].code == err || stats->error_codes[i].code == ESP_OK || i == LCD_1602_STATS_ERROR_CODES - 1) {
+            if(stats->error_codes[i].code == ESP_OK) stats->error_codes[i].code = err;
+            stats->error_codes[i].count++;
+            return;
+        }
+    }
+}
+
+/*
+Counters are written from the tasks using the display and from the i2c interrupt of queued
+transfers, so every update takes stats_lock like the copy in lcd_1602_get_stats does.
+*/
+void lcd_1602_stats_bus(lcd_1602_state_t *state, size_t sent, size_t received, esp_err_t err, int64_t us) {
+    if(state == NULL) return;
+    lcd_1602_stats_t *stats = &state->stats;
+
+    portENTER_CRITICAL_SAFE(&state->stats_lock);
+    stats->transactions++;
+    stats->bytes_sent += sent;
+    stats->bytes_received += received;
+    stats->bus_us += us;
+
+    if(err != ESP_OK) count_error(stats, err);
+    portEXIT_CRITICAL_SAFE(&state->stats_lock);
+}
+
+void lcd_1602_stats_error(lcd_1602_state_t *state, esp_err_t err) {
+    if(state == NULL) return;
+
+    portENTER_CRITICAL_SAFE(&state->stats_lock);
+    count_error(&state->stats, err);
+    portEXIT_CRITICAL_SAFE(&state->stats_lock);
+}
+
+void lcd_1602_stats_delay(lcd_1602_state_t *state, int64_t us) {
+    if(state == NULL) return;
+
+    portENTER_CRITICAL_SAFE(&state->stats_lock);
+    state->stats.delay_us += us;
+    portEXIT_CRITICAL_SAFE(&state->stats_lock);
+}
+
+void lcd_1602_stats_count(lcd_1602_state_t *state, uint32_t *counter) {
+    if(state == NULL) return;
+
+    portENTER_CRITICAL_SAFE(&state->stats_lock);
+    (*counter)++;
+    portEXIT_CRITICAL_SAFE(&state->stats_lock);
+}
+
+void lcd_1602_stats_api(lcd_1602_state_t *state, LCD_1602_API api, int64_t us) {
+    if(state == NULL || api >= LCD_1602_API_COUNT) return;
+
+    uint32_t latency = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+
+    portENTER_CRITICAL_SAFE(&state->stats_lock);
+    state->stats.api[api].calls++;
+    state->stats.api[api].total_us += latency;
+    if(latency > state->stats.api[api].max_us) state->stats.api[api].max_us = latency;
+    state->stats.api[api].histogram[bucket_of(latency)]++;
+    portEXIT_CRITICAL_SAFE(&state->stats_lock);
+}
+
+uint8_t lcd_1602_get_stats(i2c_master_dev_handle_t handle, lcd_1602_stats_t *stats, bool reset) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || stats == NULL) return 1;
+
+    /*
+    The lock is taken from the i2c interrupt too, so it is held for one group of counters at a
+    time instead of the whole struct: the bus counters, then the latency of each call. Every
+    group is consistent, calls that return during the copy may show up in some groups only.
+    */
+    const size_t bus_bytes = offsetof(lcd_1602_stats_t, api);
+
+    taskENTER_CRITICAL(&state->stats_lock);
+    memcpy(stats, &state->stats, bus_bytes);
+    if(reset) memset(&state->stats, 0, bus_bytes);
+    taskEXIT_CRITICAL(&state->stats_lock);
+
+    for(uint8_t api = 0; api < LCD_1602_API_COUNT; api++) {
+        taskENTER_CRITICAL(&state->stats_lock);
+        stats->api[api] = state->stats.api[api];
+        if(reset) memset(&state->stats.api[api], 0, sizeof(state->stats.api[api]));
+        taskEXIT_CRITICAL(&state->stats_lock);
+    }
+
+    return 0;
+}
+
+#else
+
+uint8_t lcd_1602_get_stats(i2c_master_dev_handle_t handle, lcd_1602_stats_t *stats, bool reset) {
+    (void)handle;
+    (void)stats;
+    (void)reset;
+    return 1;
+}
+
+#endif
+
+/** @} lcd_1602_driver */
@@ -0,0 +1,103 @@
+/**
+ *
+ * @file:       lcd_1602_trace.c
+ * @author:     Carl Broman <carl.broman@yh.nackademin.se>
+ * @brief:      Lock-free trace ring of the i2c transfers of each display.
+ * @addtogroup @lcd_1602_driver
+ *  @{
+ -------------------------------------------------------------------------------------------------*/
+
+#include "internal/lcd_1602_internal.h"
+#include <string.h>
+
+#if LCD_1602_ENABLE_TRACE
+
+#if (LCD_1602_TRACE_ENTRIES & (LCD_1602_TRACE_ENTRIES - 1)) != 0 || LCD_1602_TRACE_ENTRIES > 128
+#error "LCD_1602_TRACE_ENTRIES must be a power of two up to 128"
+#endif
+#if LCD_1602_TRACE_ENTRIES * LCD_1602_TRACE_DATA_BYTES < LCD_1602_TX_BUF_BYTES
+#error "LCD_1602_TRACE_ENTRIES is too small to hold the longest transfer"
+#endif
+#if LCD_1602_TRACE_DATA_BYTES > LCD_1602_TRACE_LEN_MASK
+#error "LCD_1602_TRACE_DATA_BYTES does not fit in the length bits of an entry"
+#endif
+
+void lcd_1602_trace(lcd_1602_state_t *state, uint8_t flags, const uint8_t *buf, size_t len, esp_err_t err, uint32_t time_us) {
+    if(state == NULL) return;
+
+    uint32_t count = len == 0 ? 1 : (len + LCD_1602_TRACE_DATA_BYTES - 1) / LCD_1602_TRACE_DATA_BYTES;
+    uint32_t n = __atomic_fetch_add(&state->trace_next, count, __ATOMIC_RELAXED);
+
+    for(uint32_t i = 0; i < count; i++, n++) {
+        lcd_1602_trace_entry_t *entry = &state->trace[n % LCD_1602_TRACE_ENTRIES];
+        size_t offset = i * LCD_1602_TRACE_DATA_BYTES;
+        uint8_t used = len - offset < LCD_1602_TRACE_DATA_BYTES ? len - offset : LCD_1602_TRACE_DATA_BYTES;
+
+        // ~n never matches the number of this or the previous lap of the slot, so a reader skips the entry until it is done
+        __atomic_store_n(&entry->seq, (uint8_t)~n, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        entry->time_us = time_us;
+        entry->result = (int16_t)err;
+        entry->info = used | flags | (i > 0 ? LCD_1602_TRACE_CONT : 0);
+        if(used > 0) memcpy(entry->data, buf + offset, used);
+
+        __atomic_store_n(&entry->seq, (uint8_t)n, __ATOMIC_RELEASE);
+    }
+}
+
+size_t lcd_1602_trace_dump(i2c_master_dev_handle_t handle, void *buf, size_t size) {
+    lcd_1602_state_t *state = lcd_1602_get_state(handle);
+    if(state == NULL || buf == NULL || size < sizeof(lcd_1602_trace_header_t)) return 0;
+
+    uint32_t next = __atomic_load_n(&state->trace_next, __ATOMIC_ACQUIRE);
+    uint32_t count = next < LCD_1602_TRACE_ENTRIES ? next : LCD_1602_TRACE_ENTRIES;
+    uint32_t room = (size - sizeof(lcd_1602_trace_header_t)) / sizeof(lcd_1602_trace_entry_t);
+    if(count > room) count = room;
+
+    lcd_1602_trace_header_t header = {
+        .magic = LCD_1602_TRACE_MAGIC,
+        .version = LCD_1602_TRACE_VERSION,
+        .entry_bytes = sizeof(lcd_1602_trace_entry_t),
+        .count = 0,
+        .first = next - count,
+    };
+    uint8_t *out = (uint8_t *)buf + sizeof(header);
+
+    for(uint32_t n = next - count; n != next; n++) {
+        const lcd_1602_trace_entry_t *entry = &state->trace[n % LCD_1602_TRACE_ENTRIES];
+        lcd_1602_trace_entry_t copy;
+
+        uint8_t seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+        memcpy(&copy, entry, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if(seq != (uint8_t)n || __atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq) {
+            // The oldest entries are being overwritten, the newest ones are not finished yet
+            if(header.count == 0) {
+                header.first = n + 1;
+                continue;
+            }
+            break;
+        }
+
+        memcpy(out + header.count * sizeof(copy), &copy, sizeof(copy));
+        header.count++;
+    }
+
+    memcpy(buf, &header, sizeof(header));
+    return sizeof(header) + header.count * sizeof(lcd_1602_trace_entry_t);
+}
+
+#else
+
+size_t lcd_1602_trace_dump(i2c_master_dev_handle_t handle, void *buf, size_t size) {
+    (void)handle;
+    (void)buf;
+    (void)size;
+    return 0;
+}
+
+#endif
+
+/** @} lcd_1602_driver */